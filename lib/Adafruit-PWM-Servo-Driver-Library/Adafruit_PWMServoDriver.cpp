@@ -30,6 +30,10 @@
 #include "Adafruit_PWMServoDriver.h"
 #include <Wire.h>
 
+#define PCA9685_KNOWN_MODE1 0x01    /**< _mode1 matches the chip */
+#define PCA9685_KNOWN_MODE2 0x02    /**< _mode2 matches the chip */
+#define PCA9685_KNOWN_PRESCALE 0x04 /**< _prescale matches the chip */
+
 /*!
  *  @brief  Instantiates a new PCA9685 PWM driver chip with the I2C address on a
  * TwoWire interface
@@ -40,6 +44,10 @@
 Adafruit_PWMServoDriver::Adafruit_PWMServoDriver(uint8_t addr, TwoWire *i2c) {
   _i2c = i2c;
   _i2caddr = addr;
+  _staged = 0;
+  _issued = 0;
+  _suppressed = 0;
+  invalidateCache();
 }
 
 /*!
@@ -64,6 +72,7 @@ void Adafruit_PWMServoDriver::begin(uint8_t prescale) {
  */
 void Adafruit_PWMServoDriver::reset() {
   write8(PCA9685_MODE1, 0x80);
+  invalidateCache();
   delay(10);
 }
 
@@ -142,6 +151,12 @@ void Adafruit_PWMServoDriver::setPWMFreq(float freq) {
   Serial.println(prescale);
 #endif
 
+  // Already running at this frequency; skip the sleep / wake cycle
+  if ((_regKnown & PCA9685_KNOWN_PRESCALE) && _prescale == prescale) {
+    _suppressed++;
+    return;
+  }
+
   uint8_t oldmode = read8(PCA9685_MODE1);
   uint8_t newmode = (oldmode & 0x7F) | 0x10; // sleep
   write8(PCA9685_MODE1, newmode);            // go to sleep
@@ -186,11 +201,96 @@ void Adafruit_PWMServoDriver::setOutputMode(bool totempole) {
 /*!
  *  @brief  Gets the PWM output of one of the PCA9685 pins
  *  @param  num One of the PWM output pins, from 0 to 15
- *  @return requested PWM output value
+ *  @param  off If true, returns the OFF tick instead of the ON tick
+ *  @return the requested tick, 0-4095, or 4096 when the full on / full off
+ * bit is set (the same encoding setPWM() takes). 0 if num is out of range.
+ */
+uint16_t Adafruit_PWMServoDriver::getPWM(uint8_t num, bool off) {
+  uint16_t onTick, offTick;
+  if (!readPWM(num, &onTick, &offTick))
+    return 0;
+  return off ? offTick : onTick;
+}
+
+/*!
+ *  @brief  Reads back the ON and OFF ticks of one of the PCA9685 pins. The
+ * shadow copy answers without using the bus when it is valid.
+ *  @param  num One of the PWM output pins, from 0 to 15
+ *  @param  on Where to store the ON tick
+ *  @param  off Where to store the OFF tick
+ *  @param  refresh If true, always read the chip (and refresh the shadow copy)
+ *  @return true if the values were read, false if num is out of range or the
+ * chip did not answer
  */
-uint8_t Adafruit_PWMServoDriver::getPWM(uint8_t num) {
-  _i2c->requestFrom((int)_i2caddr, LED0_ON_L + 4 * num, (int)4);
-  return _i2c->read();
+bool Adafruit_PWMServoDriver::readPWM(uint8_t num, uint16_t *on, uint16_t *off,
+                                      bool refresh) {
+  return readPWMRange(num, 1, on, off, refresh) == 1;
+}
+
+/*!
+ *  @brief  Reads back the ON and OFF ticks of count consecutive pins. Pins
+ * the shadow copy doesn't know (or all of them, with refresh) are read from
+ * the chip in auto-increment bursts of up to PCA9685_READ_CHANNELS pins.
+ *  @param  first The first PWM output pin to read, from 0 to 15
+ *  @param  count How many pins to read; on and off must hold this many
+ *  @param  on Where to store the ON ticks
+ *  @param  off Where to store the OFF ticks
+ *  @param  refresh If true, always read the chip (and refresh the shadow copy)
+ *  @return the number of pins read, which is less than count if the range
+ * runs past pin 15 or the chip stops answering
+ */
+uint8_t Adafruit_PWMServoDriver::readPWMRange(uint8_t first, uint8_t count,
+                                              uint16_t *on, uint16_t *off,
+                                              bool refresh) {
+  if (first >= PCA9685_CHANNELS)
+    return 0;
+  if (count > PCA9685_CHANNELS - first)
+    count = PCA9685_CHANNELS - first;
+
+  if (refresh) {
+    for (uint8_t i = 0; i < count; i++)
+      _ledKnown &= ~((uint16_t)1 << (first + i));
+  }
+
+  uint8_t num = first;
+  while (num < first + count) {
+    if (_ledKnown & ((uint16_t)1 << num)) {
+      _suppressed++;
+      num++;
+      continue;
+    }
+
+    // Read the run of unknown pins in one go
+    uint8_t burst = 0;
+    while (num + burst < first + count &&
+           !(_ledKnown & ((uint16_t)1 << (num + burst))) &&
+           burst < PCA9685_READ_CHANNELS)
+      burst++;
+
+    _i2c->beginTransmission(_i2caddr);
+    _i2c->write(LED0_ON_L + 4 * num);
+    _i2c->endTransmission();
+    uint8_t length = 4 * burst;
+    uint8_t received =
+        _i2c->requestFrom((uint8_t)_i2caddr, length);
+    _issued += 2;
+    for (uint8_t i = 0; i < received; i++)
+      _led[4 * num + i] = _i2c->read();
+    for (uint8_t i = 0; i < received / 4; i++)
+      _ledKnown |= (uint16_t)1 << (num + i);
+    if (received < length)
+      break;
+    num += burst;
+  }
+
+  uint8_t valid = 0;
+  while (valid < count && (_ledKnown & ((uint16_t)1 << (first + valid)))) {
+    const uint8_t *led = &_led[4 * (first + valid)];
+    on[valid] = led[0] | ((uint16_t)(led[1] & 0x1F) << 8);
+    off[valid] = led[2] | ((uint16_t)(led[3] & 0x1F) << 8);
+    valid++;
+  }
+  return valid;
 }
 
 /*!
@@ -209,13 +309,22 @@ void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
   Serial.println(off);
 #endif
 
-  _i2c->beginTransmission(_i2caddr);
-  _i2c->write(LED0_ON_L + 4 * num);
-  _i2c->write(on);
-  _i2c->write(on >> 8);
-  _i2c->write(off);
-  _i2c->write(off >> 8);
-  _i2c->endTransmission();
+  if (num >= PCA9685_CHANNELS) {
+    // Not a real output; send it as-is, there is nothing to cache
+    _i2c->beginTransmission(_i2caddr);
+    _i2c->write(LED0_ON_L + 4 * num);
+    _i2c->write(on);
+    _i2c->write(on >> 8);
+    _i2c->write(off);
+    _i2c->write(off >> 8);
+    _i2c->endTransmission();
+    _issued++;
+    return;
+  }
+
+  uint8_t image[4] = {(uint8_t)on, (uint8_t)(on >> 8), (uint8_t)off,
+                      (uint8_t)(off >> 8)};
+  writeLEDs(num, 1, image);
 }
 
 /*!
@@ -229,43 +338,317 @@ void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
  *   @param  invert If true, inverts the output, defaults to 'false'
  */
 void Adafruit_PWMServoDriver::setPin(uint8_t num, uint16_t val, bool invert) {
+  uint16_t on, off;
+  pinValues(val, invert, &on, &off);
+  setPWM(num, on, off);
+}
+
+/*!
+ *  @brief  Sets every PWM output to the same value in one transaction, using
+ * the ALL_LED registers. Any staged updates are discarded.
+ *  @param  on At what point in the 4096-part cycle to turn the PWM outputs ON
+ *  @param  off At what point in the 4096-part cycle to turn the PWM outputs OFF
+ */
+void Adafruit_PWMServoDriver::setAllPWM(uint16_t on, uint16_t off) {
+  _staged = 0;
+
+  uint8_t num = 0;
+  while (num < PCA9685_CHANNELS && !ledChanged(num, on, off))
+    num++;
+  if (num == PCA9685_CHANNELS) {
+    _suppressed++;
+    return;
+  }
+
+  _i2c->beginTransmission(_i2caddr);
+  _i2c->write(ALLLED_ON_L);
+  _i2c->write(on);
+  _i2c->write(on >> 8);
+  _i2c->write(off);
+  _i2c->write(off >> 8);
+  _i2c->endTransmission();
+  _issued++;
+
+  for (num = 0; num < PCA9685_CHANNELS; num++) {
+    _led[4 * num] = on;
+    _led[4 * num + 1] = on >> 8;
+    _led[4 * num + 2] = off;
+    _led[4 * num + 3] = off >> 8;
+  }
+  _ledKnown = 0xFFFF;
+}
+
+/*!
+ *  @brief  Records a PWM update for one of the PCA9685 pins without sending
+ * it. Staged updates go out together on the next flushPWM(), so several
+ * outputs change at (nearly) the same moment. Staging a pin twice keeps the
+ * last value.
+ *  @param  num One of the PWM output pins, from 0 to 15
+ *  @param  on At what point in the 4096-part cycle to turn the PWM output ON
+ *  @param  off At what point in the 4096-part cycle to turn the PWM output OFF
+ */
+void Adafruit_PWMServoDriver::stagePWM(uint8_t num, uint16_t on,
+                                       uint16_t off) {
+  if (num >= PCA9685_CHANNELS)
+    return;
+  _stagedOn[num] = on;
+  _stagedOff[num] = off;
+  _staged |= (uint16_t)1 << num;
+}
+
+/*!
+ *  @brief  Same as setPin(), but staged until the next flushPWM()
+ *  @param  num One of the PWM output pins, from 0 to 15
+ *  @param  val The number of ticks out of 4096 to be active, from 0 to 4095
+ *  @param  invert If true, inverts the output, defaults to 'false'
+ */
+void Adafruit_PWMServoDriver::stagePin(uint8_t num, uint16_t val,
+                                       bool invert) {
+  uint16_t on, off;
+  pinValues(val, invert, &on, &off);
+  stagePWM(num, on, off);
+}
+
+/*!
+ *  @brief  Sends every staged update. If all 16 pins are staged with the same
+ * value this is a single ALL_LED write; otherwise each run of consecutive
+ * changed pins goes out as one auto-increment burst of up to
+ * PCA9685_BURST_CHANNELS pins, trimmed to the bytes that differ. Pins staged
+ * with the value they already have are skipped. Bursts rely on the auto-increment bit that
+ * begin() / setPWMFreq() turn on.
+ */
+void Adafruit_PWMServoDriver::flushPWM() {
+  if (_staged == 0)
+    return;
+
+  if (_staged == 0xFFFF) {
+    uint8_t i = 1;
+    while (i < PCA9685_CHANNELS && _stagedOn[i] == _stagedOn[0] &&
+           _stagedOff[i] == _stagedOff[0])
+      i++;
+    if (i == PCA9685_CHANNELS) {
+      setAllPWM(_stagedOn[0], _stagedOff[0]);
+      return;
+    }
+  }
+
+  // Staged channels that already hold their value need no write
+  uint16_t changed = 0;
+  for (uint8_t num = 0; num < PCA9685_CHANNELS; num++) {
+    if (!(_staged & ((uint16_t)1 << num)))
+      continue;
+    if (ledChanged(num, _stagedOn[num], _stagedOff[num]))
+      changed |= (uint16_t)1 << num;
+    else
+      _suppressed++;
+  }
+
+  uint8_t num = 0;
+  while (num < PCA9685_CHANNELS) {
+    if (!(changed & ((uint16_t)1 << num))) {
+      num++;
+      continue;
+    }
+
+    uint8_t image[PCA9685_BURST_CHANNELS * 4];
+    uint8_t first = num;
+    uint8_t count = 0;
+    while (num < PCA9685_CHANNELS && (changed & ((uint16_t)1 << num)) &&
+           count < PCA9685_BURST_CHANNELS) {
+      image[4 * count] = _stagedOn[num];
+      image[4 * count + 1] = _stagedOn[num] >> 8;
+      image[4 * count + 2] = _stagedOff[num];
+      image[4 * count + 3] = _stagedOff[num] >> 8;
+      num++;
+      count++;
+    }
+    writeLEDs(first, count, image);
+  }
+  _staged = 0;
+}
+
+/*!
+ *  @brief  Works out the ON/OFF ticks setPin() uses for a duty value
+ */
+void Adafruit_PWMServoDriver::pinValues(uint16_t val, bool invert,
+                                        uint16_t *on, uint16_t *off) {
   // Clamp value between 0 and 4095 inclusive.
   val = min(val, (uint16_t)4095);
   if (invert) {
     if (val == 0) {
       // Special value for signal fully on.
-      setPWM(num, 4096, 0);
+      *on = 4096;
+      *off = 0;
     } else if (val == 4095) {
       // Special value for signal fully off.
-      setPWM(num, 0, 4096);
+      *on = 0;
+      *off = 4096;
     } else {
-      setPWM(num, 0, 4095 - val);
+      *on = 0;
+      *off = 4095 - val;
     }
   } else {
     if (val == 4095) {
       // Special value for signal fully on.
-      setPWM(num, 4096, 0);
+      *on = 4096;
+      *off = 0;
     } else if (val == 0) {
       // Special value for signal fully off.
-      setPWM(num, 0, 4096);
+      *on = 0;
+      *off = 4096;
     } else {
-      setPWM(num, 0, val);
+      *on = 0;
+      *off = val;
     }
   }
 }
 
+/*!
+ *  @brief  Number of I2C transactions this driver has sent
+ *  @return transactions sent since the last resetWriteCounters()
+ */
+unsigned long Adafruit_PWMServoDriver::issuedWrites() const {
+  return _issued;
+}
+
+/*!
+ *  @brief  Number of register writes (and reads) that were answered from the
+ * shadow copy instead of going out on the bus
+ *  @return transactions saved since the last resetWriteCounters()
+ */
+unsigned long Adafruit_PWMServoDriver::suppressedWrites() const {
+  return _suppressed;
+}
+
+/*!
+ *  @brief  Zeroes issuedWrites() and suppressedWrites()
+ */
+void Adafruit_PWMServoDriver::resetWriteCounters() {
+  _issued = 0;
+  _suppressed = 0;
+}
+
+/*!
+ *  @brief  Forgets the shadow copy of the chip's registers, so the next write
+ * to each one is sent. Call this if something else may have changed the chip
+ * (another driver object, a power glitch, ...).
+ */
+void Adafruit_PWMServoDriver::invalidateCache() {
+  _ledKnown = 0;
+  _regKnown = 0;
+}
+
+/*!
+ *  @brief  Whether setting a channel to on/off would change it
+ */
+bool Adafruit_PWMServoDriver::ledChanged(uint8_t num, uint16_t on,
+                                         uint16_t off) {
+  if (!(_ledKnown & ((uint16_t)1 << num)))
+    return true;
+  const uint8_t *led = &_led[4 * num];
+  return led[0] != (uint8_t)on || led[1] != (uint8_t)(on >> 8) ||
+         led[2] != (uint8_t)off || led[3] != (uint8_t)(off >> 8);
+}
+
+/*!
+ *  @brief  Writes the LED registers of count consecutive channels, sending
+ * only the span of bytes that differs from the shadow copy
+ */
+void Adafruit_PWMServoDriver::writeLEDs(uint8_t first, uint8_t count,
+                                        const uint8_t *image) {
+  uint8_t length = 4 * count;
+  uint8_t *shadow = &_led[4 * first];
+  uint8_t lo = length;
+  uint8_t hi = 0;
+  for (uint8_t i = 0; i < length; i++) {
+    bool known = _ledKnown & ((uint16_t)1 << (first + i / 4));
+    if (!known || shadow[i] != image[i]) {
+      if (lo == length)
+        lo = i;
+      hi = i;
+    }
+  }
+  if (lo == length) {
+    _suppressed++;
+    return;
+  }
+
+  _i2c->beginTransmission(_i2caddr);
+  _i2c->write(LED0_ON_L + 4 * first + lo);
+  for (uint8_t i = lo; i <= hi; i++)
+    _i2c->write(image[i]);
+  _i2c->endTransmission();
+  _issued++;
+
+  memcpy(shadow, image, length);
+  for (uint8_t i = 0; i < count; i++)
+    _ledKnown |= (uint16_t)1 << (first + i);
+}
+
+/*!
+ *  @brief  The shadow copy of a mode / prescale register, or nullptr for
+ * registers that aren't cached
+ */
+uint8_t *Adafruit_PWMServoDriver::shadowRegister(uint8_t addr,
+                                                 uint8_t *knownBit) {
+  switch (addr) {
+  case PCA9685_MODE1:
+    *knownBit = PCA9685_KNOWN_MODE1;
+    return &_mode1;
+  case PCA9685_MODE2:
+    *knownBit = PCA9685_KNOWN_MODE2;
+    return &_mode2;
+  case PCA9685_PRESCALE:
+    *knownBit = PCA9685_KNOWN_PRESCALE;
+    return &_prescale;
+  default:
+    return nullptr;
+  }
+}
+
 uint8_t Adafruit_PWMServoDriver::read8(uint8_t addr) {
+  uint8_t knownBit;
+  uint8_t *shadow = shadowRegister(addr, &knownBit);
+  if (shadow && (_regKnown & knownBit)) {
+    _suppressed++;
+    return *shadow;
+  }
+
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(addr);
   _i2c->endTransmission();
 
   _i2c->requestFrom((uint8_t)_i2caddr, (uint8_t)1);
-  return _i2c->read();
+  uint8_t value = _i2c->read();
+  _issued += 2;
+
+  if (shadow) {
+    // The RESTART bit is set by the chip itself; don't trust it later
+    *shadow = (addr == PCA9685_MODE1) ? (value & 0x7F) : value;
+    _regKnown |= knownBit;
+  }
+  return value;
 }
 
 void Adafruit_PWMServoDriver::write8(uint8_t addr, uint8_t d) {
+  uint8_t knownBit;
+  uint8_t *shadow = shadowRegister(addr, &knownBit);
+  // Writing RESTART always has an effect, so never skip it
+  bool restart = (addr == PCA9685_MODE1) && (d & 0x80);
+  if (shadow && (_regKnown & knownBit) && *shadow == d && !restart) {
+    _suppressed++;
+    return;
+  }
+
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(addr);
   _i2c->write(d);
   _i2c->endTransmission();
+  _issued++;
+
+  if (shadow) {
+    // Writing 1 to RESTART clears it
+    *shadow = restart ? (d & 0x7F) : d;
+    _regKnown |= knownBit;
+  }
 }
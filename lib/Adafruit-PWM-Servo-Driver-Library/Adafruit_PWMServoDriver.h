@@ -43,6 +43,20 @@
 #define ALLLED_OFF_L 0xFC /**< load all the LEDn_OFF registers, byte 0 */
 #define ALLLED_OFF_H 0xFD /**< load all the LEDn_OFF registers, byte 1 */
 
+#define PCA9685_CHANNELS 16 /**< number of PWM outputs */
+
+#ifdef BUFFER_LENGTH
+#define PCA9685_WIRE_BUFFER BUFFER_LENGTH /**< bytes Wire can send at once */
+#else
+#define PCA9685_WIRE_BUFFER 32 /**< bytes Wire can send at once */
+#endif
+
+/** Channels that fit in one auto-increment burst after the register byte */
+#define PCA9685_BURST_CHANNELS ((PCA9685_WIRE_BUFFER - 1) / 4)
+
+/** Channels that fit in one auto-increment read */
+#define PCA9685_READ_CHANNELS (PCA9685_WIRE_BUFFER / 4)
+
 /*! 
  *  @brief  Class that stores state and functions for interacting with PCA9685 PWM chip
  */
@@ -56,15 +70,47 @@ class Adafruit_PWMServoDriver {
   void setExtClk(uint8_t prescale);
   void setPWMFreq(float freq);
   void setOutputMode(bool totempole);
-  uint8_t getPWM(uint8_t num);
+  uint16_t getPWM(uint8_t num, bool off = false);
+  bool readPWM(uint8_t num, uint16_t *on, uint16_t *off, bool refresh = false);
+  uint8_t readPWMRange(uint8_t first, uint8_t count, uint16_t *on,
+                       uint16_t *off, bool refresh = false);
   void setPWM(uint8_t num, uint16_t on, uint16_t off);
   void setPin(uint8_t num, uint16_t val, bool invert=false);
+  void setAllPWM(uint16_t on, uint16_t off);
+  void stagePWM(uint8_t num, uint16_t on, uint16_t off);
+  void stagePin(uint8_t num, uint16_t val, bool invert=false);
+  void flushPWM();
+  unsigned long issuedWrites() const;
+  unsigned long suppressedWrites() const;
+  void resetWriteCounters();
+  void invalidateCache();
 
  private:
   uint8_t _i2caddr;
   
   TwoWire *_i2c;
 
+  uint16_t _staged; // bit n set when channel n has a staged update
+  uint16_t _stagedOn[PCA9685_CHANNELS];
+  uint16_t _stagedOff[PCA9685_CHANNELS];
+
+  // Shadow copy of the chip's registers, so writes that change nothing can
+  // be skipped. _led holds LED0_ON_L onwards, 4 bytes per channel.
+  uint8_t _led[PCA9685_CHANNELS * 4];
+  uint16_t _ledKnown; // bit n set when channel n's shadow matches the chip
+  uint8_t _mode1;
+  uint8_t _mode2;
+  uint8_t _prescale;
+  uint8_t _regKnown; // PCA9685_KNOWN_* bits
+
+  unsigned long _issued;
+  unsigned long _suppressed;
+
+  void pinValues(uint16_t val, bool invert, uint16_t *on, uint16_t *off);
+  bool ledChanged(uint8_t num, uint16_t on, uint16_t off);
+  void writeLEDs(uint8_t first, uint8_t count, const uint8_t *image);
+  uint8_t *shadowRegister(uint8_t addr, uint8_t *knownBit);
+
   uint8_t read8(uint8_t addr);
   void write8(uint8_t addr, uint8_t d);
 };
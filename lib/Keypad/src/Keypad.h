@@ -76,6 +76,8 @@ class Keypad : public Key {
 public:
 
 	Keypad(char *userKeymap, byte *row, byte *col, byte numRows, byte numCols);
+	// The class has virtual functions, so its destructor is virtual too
+	virtual ~Keypad() {}
 
 	virtual void pin_mode(byte pinNum, byte mode) { pinMode(pinNum, mode); }
 	virtual void pin_write(byte pinNum, boolean level) { digitalWrite(pinNum, level); }
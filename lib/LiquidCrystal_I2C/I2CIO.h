@@ -137,6 +137,21 @@ public:
     */   
    int write ( uint8_t value );
    
+   /*!
+    @method
+    @abstract   Write several values to the device in one transaction.
+    @discussion Same as write(uint8_t) for each value in turn, but all of them
+    go in a single I2C transaction, so the address and start/stop conditions
+    are only sent once. The device's outputs take each value as its byte
+    arrives, one byte time apart. count must fit the Wire buffer
+    (BUFFER_LENGTH, 32 bytes on the Arduino).
+    
+    @param      values[in] values to be written to the device, in order.
+    @param      count[in] how many values to write.
+    @result     1 on success, 0 otherwise
+    */   
+   int write ( const uint8_t *values, uint8_t count );
+   
    /*!
     @method
     @abstract   Writes a digital level to a particular pin.
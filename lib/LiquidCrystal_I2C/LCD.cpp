@@ -189,6 +189,11 @@ void LCD::home()
    delayMicroseconds(HOME_CLEAR_EXEC);  // This command is time consuming
 }
 
+void LCD::startClear()
+{
+   command(LCD_CLEARDISPLAY);           // the caller waits HOME_CLEAR_EXEC
+}
+
 void LCD::setCursor(uint8_t col, uint8_t row)
 {
    const byte row_offsetsDef[]   = { 0x00, 0x40, 0x14, 0x54 }; // For regular LCDs
@@ -250,6 +250,18 @@ public:
     */
    void home();
    
+   /*!
+    @function
+    @abstract   Starts clearing the LCD without waiting for it.
+    @discussion Same as clear(), but returns as soon as the command is sent
+    instead of waiting the HOME_CLEAR_EXEC microseconds the LCD takes to carry
+    it out. The caller must not send anything else to the LCD until that time
+    has passed.
+    
+    @param      none
+    */
+   void startClear();
+   
    /*!
     @function
     @abstract   Turns off the LCD display.
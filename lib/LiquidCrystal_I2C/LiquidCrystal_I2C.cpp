@@ -66,6 +66,14 @@
  */
 #define LCD_BACKLIGHT   0xFF
 
+/*!
+ @defined 
+ @abstract   LCD_I2C_STREAM_CHARS
+ @discussion Characters write() packs into one I2C transaction, 4 expander
+ words each. 16 bytes fit the Wire buffer (32 bytes) and TinyWireM's (18).
+ */
+#define LCD_I2C_STREAM_CHARS 4
+
 
 // Default library configuration parameters used by class constructor with
 // only the I2C address field.
@@ -261,14 +269,73 @@ void LiquidCrystal_I2C::send(uint8_t value, uint8_t mode)
    }
    else 
    {
-      write4bits( (value >> 4), mode );
-      write4bits( (value & 0x0F), mode);
+      // Both nibbles in one transaction instead of four
+      uint8_t words[4];
+      pack ( words, value, mode );
+      _i2cio.write ( words, 4 );
+   }
+}
+
+#if (ARDUINO >= 100)
+//
+// write - stream a run of characters
+size_t LiquidCrystal_I2C::write(const uint8_t *buffer, size_t size)
+{
+   // Each character is 4 expander words. At 400kHz the first falling edge of
+   // En for the next character comes 2 bytes (45us) after the last one, longer
+   // than the 37us the controller needs to store a character.
+   uint8_t words[LCD_I2C_STREAM_CHARS * 4];
+   size_t sent = 0;
+   
+   while ( sent < size )
+   {
+      uint8_t count = 0;
+      while ( count < LCD_I2C_STREAM_CHARS && sent + count < size )
+      {
+         pack ( &words[count * 4], buffer[sent + count], LCD_DATA );
+         count++;
+      }
+      _i2cio.write ( words, count * 4 );
+      sent += count;
    }
+   return sent;
 }
+#endif
 
 //
 // write4bits
 void LiquidCrystal_I2C::write4bits ( uint8_t value, uint8_t mode ) 
+{
+   pulseEnable ( mapNibble ( value, mode ) );
+}
+
+//
+// pulseEnable
+void LiquidCrystal_I2C::pulseEnable (uint8_t data)
+{
+   uint8_t words[2];
+   
+   words[0] = data | _En;    // En HIGH
+   words[1] = data & ~_En;   // En LOW
+   _i2cio.write ( words, 2 );
+}
+
+//
+// pack
+void LiquidCrystal_I2C::pack ( uint8_t *words, uint8_t value, uint8_t mode )
+{
+   uint8_t high = mapNibble ( value >> 4, mode );
+   uint8_t low = mapNibble ( value & 0x0F, mode );
+   
+   words[0] = high | _En;    // En HIGH
+   words[1] = high & ~_En;   // En LOW
+   words[2] = low | _En;
+   words[3] = low & ~_En;
+}
+
+//
+// mapNibble
+uint8_t LiquidCrystal_I2C::mapNibble ( uint8_t value, uint8_t mode )
 {
    uint8_t pinMapValue = 0;
    
@@ -290,14 +357,5 @@ void LiquidCrystal_I2C::write4bits ( uint8_t value, uint8_t mode )
       mode = _Rs;
    }
    
-   pinMapValue |= mode | _backlightStsMask;
-   pulseEnable ( pinMapValue );
-}
-
-//
-// pulseEnable
-void LiquidCrystal_I2C::pulseEnable (uint8_t data)
-{
-   _i2cio.write (data | _En);   // En HIGH
-   _i2cio.write (data & ~_En);  // En LOW
+   return pinMapValue | mode | _backlightStsMask;
 }
\ No newline at end of file
@@ -135,6 +135,22 @@ public:
     */
    virtual void send(uint8_t value, uint8_t mode);
 
+#if (ARDUINO >= 100)
+   /*!
+    @function
+    @abstract   Writes a run of characters to the LCD.
+    @discussion Streams the characters to the IO expander, several of them in
+    each I2C transaction (as many as fit the Wire buffer), instead of one
+    transaction per character. print() of a string or number ends up here.
+
+    @param      buffer[in] characters to write at the cursor.
+    @param      size[in] how many characters to write.
+    @result     the number of characters written.
+    */
+   virtual size_t write(const uint8_t *buffer, size_t size);
+   using LCD::write;
+#endif
+
    /*!
     @function
     @abstract   Sets the pin to control the backlight.
@@ -202,6 +218,26 @@ private:
     */
    void pulseEnable(uint8_t);
 
+   /*!
+    @method
+    @abstract   Expander words that send one value to the LCD.
+    @discussion Puts the 4 words (En high and En low for each nibble) that
+    send value to the LCD in words, ready to go in one transaction.
+    @param      words[out] 4 expander words
+    @param      value[in] value to send
+    @param      mode[in] LCD_DATA or COMMAND
+    */
+   void pack(uint8_t *words, uint8_t value, uint8_t mode);
+
+   /*!
+    @method
+    @abstract   Maps a nibble to the expander's pins.
+    @discussion Expander word with the 4 least significant bits of value on
+    the LCD data lines, and Rs and the backlight as mode and the backlight
+    status want them. En is left low.
+    */
+   uint8_t mapNibble(uint8_t value, uint8_t mode);
+
 
    uint8_t _Addr;             // I2C Address of the IO expander
    uint8_t _backlightPinMask; // Backlight IO pin mask
@@ -0,0 +1,463 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  knw_bench.cpp - Runs the KNWRobot hot paths against the simulated HAL and
+  reports how long each one holds the CPU (in virtual microseconds) and how
+  much I2C traffic it generates. Output is deterministic, so two runs can be
+  diffed to see the effect of a change.
+*/
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "ArduinoSim.h"
+#include "SimDevices.h"
+#include "KNWRobot.h"
+#include "KNWConfig.h"
+#include "KNWFormat.h"
+
+#define LOOP_ITERATIONS 1000
+
+static void report(const char *name, double value, const char *unit)
+{
+     printf("%-32s %12.1f %s\n", name, value, unit);
+}
+
+int main()
+{
+     ArduinoSim::reset();
+
+     SimLCD1602 lcd(0x27);
+     SimPCA9685 pca(0x40);
+     ArduinoSim::attachI2C(&lcd);
+     ArduinoSim::attachI2C(&pca);
+
+     // ******************************************* //
+     // Construction: keypad, LCD and PCA setup
+     // ******************************************* //
+     uint64_t start = ArduinoSim::now();
+     KNWRobot *robot = new KNWRobot(0x27);
+     report("construct", ArduinoSim::now() - start, "us");
+     report("construct i2c transactions", ArduinoSim::stats().i2cWrites + ArduinoSim::stats().i2cReads, "");
+
+     const int bumpId = 1, pingId = 2, servoId = 3, irId = 4;
+     robot->setupBump(bumpId, 22);
+     robot->setupPing(pingId, 24, 25);
+     robot->setupServo(servoId, 26, 90);
+     robot->setupIncline(0);
+     robot->setupIR(irId, 30);
+
+     SimUltrasonic sonar(24, 25);
+     sonar.setDistance(40);
+     ArduinoSim::setAnalog(0, 512);
+
+     // ******************************************* //
+     // Typical control loop
+     // ******************************************* //
+     ArduinoSim::clearStats();
+     start = ArduinoSim::now();
+     for (int i = 0; i < LOOP_ITERATIONS; i++)
+     {
+          robot->getBump(bumpId);
+          robot->getIncline();
+          long cm = robot->getPing(pingId);
+          robot->pca180Servo(servoId, cm > 30 ? 90 : 0);
+          robot->moveCursor(0, 1);
+          robot->printLCD(cm);
+     }
+     SimStats loopStats = ArduinoSim::stats();
+     report("control loop", (double)(ArduinoSim::now() - start) / LOOP_ITERATIONS, "us/iter");
+     report("control loop i2c transactions",
+            (double)(loopStats.i2cWrites + loopStats.i2cReads) / LOOP_ITERATIONS, "/iter");
+     report("control loop i2c bus time", (double)loopStats.i2cBusUs / LOOP_ITERATIONS, "us/iter");
+
+     // ******************************************* //
+     // IR: beacon sending "KNW" while scanIR listens
+     // ******************************************* //
+     SimIRBeacon beacon(30);
+     beacon.send(ArduinoSim::now() + 2000, "KNW");
+     start = ArduinoSim::now();
+     int chars = robot->scanIR(irId);
+     report("scanIR", ArduinoSim::now() - start, "us");
+     report("scanIR chars", chars, "");
+
+     // Same beacon, read with availableIR()/readIR() from a control loop
+     uint64_t beaconEnd = beacon.send(ArduinoSim::now() + 2000, "KNW");
+     int received = 0;
+     int loops = 0;
+     ArduinoSim::clearStats();
+     start = ArduinoSim::now();
+     while (ArduinoSim::now() < beaconEnd + 1000)
+     {
+          robot->getBump(bumpId);
+          robot->getIncline();
+          while (robot->availableIR(irId) > 0)
+          {
+               robot->readIR(irId);
+               received++;
+          }
+          loops++;
+     }
+     report("readIR loop", (double)(ArduinoSim::now() - start) / loops, "us/iter");
+     report("readIR loop chars", received, "");
+     report("readIR loop interrupts", ArduinoSim::stats().interrupts, "");
+
+     // Three more sensors facing different ways; one beacon is heard by two
+     // of them and the third sees nothing
+     const int irLeft = 5, irRight = 6, irBack = 7;
+     robot->setupIR(irLeft, 31);
+     robot->setupIR(irRight, 32);
+     robot->setupIR(irBack, 33);
+     SimIRBeacon left(31), right(32);
+     left.send(ArduinoSim::now() + 2000, 'A');
+     right.send(ArduinoSim::now() + 2000, 'A');
+     start = ArduinoSim::now();
+     int hit = robot->scanIRAll(true);
+     report("scanIRAll first frame", ArduinoSim::now() - start, "us");
+     report("scanIRAll sensors hit", hit, "");
+
+     // A beacon repeating "KNW" twelve times while the loop only checks
+     // availableIR(): the message is recognised once and the unread
+     // characters overflow
+     long droppedBefore = robot->droppedIR(irId);
+     uint64_t repeatEnd = beacon.send(ArduinoSim::now() + 2000, "KNWKNWKNWKNWKNWKNWKNWKNWKNWKNWKNWKNW");
+     while (ArduinoSim::now() < repeatEnd + 25000)
+     {
+          robot->getBump(bumpId);
+          robot->availableIR(irId);
+     }
+     printf("IR message \"%s\"\n", robot->getIRMessage(irId));
+     report("IR message repeats", robot->repeatsIR(irId), "");
+     report("IR frames dropped", robot->droppedIR(irId) - droppedBefore, "");
+
+     // ******************************************* //
+     // PCA9685: four drive channels, one at a time vs. staged
+     // ******************************************* //
+     Adafruit_PWMServoDriver driver(0x40);
+     ArduinoSim::clearStats();
+     for (uint8_t ch = 0; ch < 4; ch++)
+          driver.setPWM(ch, 0, 300 + ch);
+     report("pca 4 channels setPWM", ArduinoSim::stats().i2cBusUs, "us bus");
+     ArduinoSim::clearStats();
+     for (uint8_t ch = 0; ch < 4; ch++)
+          driver.stagePWM(ch, 0, 400 + ch);
+     driver.flushPWM();
+     report("pca 4 channels staged", ArduinoSim::stats().i2cBusUs, "us bus");
+     ArduinoSim::clearStats();
+     for (uint8_t ch = 0; ch < 16; ch++)
+          driver.stagePWM(ch, 0, 0);
+     driver.flushPWM();
+     report("pca all off staged", ArduinoSim::stats().i2cBusUs, "us bus");
+     report("pca all off transactions", ArduinoSim::stats().i2cWrites, "");
+
+     // A control loop re-sending the same speeds: the shadow registers
+     // keep unchanged writes off the bus
+     driver.resetWriteCounters();
+     ArduinoSim::clearStats();
+     for (int i = 0; i < LOOP_ITERATIONS; i++)
+     {
+          driver.setPWM(0, 0, 350);
+          driver.setPWM(1, 0, i < LOOP_ITERATIONS / 2 ? 350 : 360);
+     }
+     report("pca repeated writes issued", driver.issuedWrites(), "");
+     report("pca repeated writes suppressed", driver.suppressedWrites(), "");
+     report("pca repeated writes bus time", ArduinoSim::stats().i2cBusUs, "us");
+
+     // Reading every channel back: once from the chip, then from the cache
+     uint16_t onTicks[16], offTicks[16];
+     ArduinoSim::clearStats();
+     int readBack = driver.readPWMRange(0, 16, onTicks, offTicks, true);
+     report("pca readback chip", ArduinoSim::stats().i2cBusUs, "us bus");
+     ArduinoSim::clearStats();
+     driver.readPWMRange(0, 16, onTicks, offTicks);
+     report("pca readback cached", ArduinoSim::stats().i2cBusUs, "us bus");
+     report("pca readback channels", readBack, "");
+     report("pca readback channel 1 off", offTicks[1], "");
+
+     // Drive motors on the PCA board: pulses come from the board, the
+     // Servo library's timer interrupt only serves the digital-pin servo
+     const int leftMotor = 8, rightMotor = 9;
+     robot->setupMotor(leftMotor, 4, 90, 'p');
+     robot->setupMotor(rightMotor, 5, 90, 'p');
+     ArduinoSim::clearStats();
+     start = ArduinoSim::now();
+     for (int i = 0; i < LOOP_ITERATIONS; i++)
+          robot->pcaDC2Motors(leftMotor, i < LOOP_ITERATIONS / 2 ? 120 : 60, rightMotor, 60);
+     report("pcaDC2Motors on PCA", (double)(ArduinoSim::now() - start) / LOOP_ITERATIONS, "us/iter");
+     report("pcaDC2Motors i2c transactions", ArduinoSim::stats().i2cWrites, "");
+     report("pcaDC2Motors left pulse", pca.off(4), "ticks");
+     report("Servo library timer users", Servo::attachedCount(), "");
+
+     // Two timed motions overlapping while the loop keeps reading sensors
+     static int finished = 0;
+     int driveAction = robot->pcaDC2MotorsTimeAsync(leftMotor, 120, rightMotor, 120, 500, [] { finished++; });
+     robot->pcaContServoTimeAsync(servoId, 45, 200, [] { finished++; });
+     loops = 0;
+     start = ArduinoSim::now();
+     while (!robot->actionDone(driveAction))
+     {
+          robot->update();
+          robot->getBump(bumpId);
+          robot->getPing(pingId);
+          loops++;
+     }
+     report("timed motions", ArduinoSim::now() - start, "us");
+     report("timed motions loop iterations", loops, "");
+     report("timed motions finished", finished, "");
+     report("timed motions left pulse", pca.off(4), "ticks");
+
+     // ******************************************* //
+     // Background pings: three sensors taking turns
+     // ******************************************* //
+     const int pingLeft = 8, pingRight = 9;
+     robot->setupPing(pingLeft, 34, 35);
+     robot->setupPing(pingRight, 36, 37);
+     SimUltrasonic sonarLeft(34, 35), sonarRight(36, 37);
+     sonarLeft.setDistance(75);
+     sonarRight.setDistance(0);
+     unsigned long pingsBefore = sonar.pings();
+     // The left sensor is noisy: every third ping is lost or wild
+     robot->setPingFilter(pingLeft, 'm', 5);
+     robot->setPingFilter(pingId, 'e', 5);
+     robot->startPings();
+     loops = 0;
+     start = ArduinoSim::now();
+     while (ArduinoSim::now() - start < 1000000)
+     {
+          robot->update();
+          robot->getBump(bumpId);
+          robot->getPingCached(pingId);
+          robot->getPingFiltered(pingLeft);
+          unsigned long leftPings = sonarLeft.pings();
+          sonarLeft.setDistance(leftPings % 3 != 2 ? 75 : (leftPings % 2 ? 0 : 150));
+          loops++;
+     }
+     robot->stopPings();
+     report("background pings loop", (double)(ArduinoSim::now() - start) / loops, "us/iter");
+     report("background pings per sensor", (double)(sonar.pings() - pingsBefore), "/s");
+     report("background ping cached", robot->getPingCached(pingId), "cm");
+     report("background ping left", robot->getPingCached(pingLeft), "cm");
+     report("background ping right", robot->getPingCached(pingRight), "cm");
+     report("filtered ping", robot->getPingFiltered(pingId), "cm");
+     report("filtered ping left (median)", robot->getPingFiltered(pingLeft), "cm");
+     report("filtered ping left valid", robot->getPingValid(pingLeft), "/5");
+     report("filtered ping right valid", robot->getPingValid(pingRight), "/5");
+     report("background ping age", millis() - robot->getPingTime(pingId), "ms");
+
+     // The same 2280us echo at NewPing's speed of sound, and in a cold and a hot room
+     report("getPingMM", robot->getPingMM(pingId), "mm");
+     robot->setPingTemperature(0);
+     report("getPingMM at 0C", robot->getPingMM(pingId), "mm");
+     robot->setPingTemperature(350);
+     report("getPingMM at 35C", robot->getPingMM(pingId), "mm");
+
+     // ******************************************* //
+     // Temperature probe: noisy readings averaged in the background
+     // ******************************************* //
+     ArduinoSim::setAnalogSource(8, [](uint64_t t) { return (uint16_t)(447 + (t / 1000) % 7); });
+     robot->setupTemp(8);
+     robot->calibrateTemp(400, 200, 600, 300);
+     loops = 0;
+     ArduinoSim::clearStats();
+     start = ArduinoSim::now();
+     while (ArduinoSim::now() - start < 500000)
+     {
+          robot->update();
+          robot->getTemp();
+          loops++;
+     }
+     report("temperature loop", (double)(ArduinoSim::now() - start) / loops, "us/iter");
+     report("temperature analogReads", ArduinoSim::stats().analogReads, "");
+     report("getTemp", robot->getTemp(), "");
+     report("getTempTenthsC", robot->getTempTenthsC(), "");
+     report("getPingMM at probe temperature", robot->getPingMM(pingId), "mm");
+
+     // ******************************************* //
+     // Analog sampler: incline and temperature read in the background
+     // ******************************************* //
+     start = ArduinoSim::now();
+     for (int i = 0; i < LOOP_ITERATIONS; i++)
+          robot->getIncline();
+     report("getIncline", (double)(ArduinoSim::now() - start) / LOOP_ITERATIONS, "us");
+     robot->startAnalogSampling();
+     loops = 0;
+     ArduinoSim::clearStats();
+     start = ArduinoSim::now();
+     while (loops < LOOP_ITERATIONS)
+     {
+          robot->update();
+          for (int i = 0; i < 8; i++)
+               robot->getIncline();
+          loops++;
+     }
+     report("sampled loop (8 getIncline)", (double)(ArduinoSim::now() - start) / loops, "us/iter");
+     report("sampled loop analogReads", (double)ArduinoSim::stats().analogReads / loops, "/iter");
+     report("sampled getIncline", robot->getIncline(), "");
+
+     // ******************************************* //
+     // Conductivity probe
+     // ******************************************* //
+     ArduinoSim::setAnalog(2, 700);
+     ArduinoSim::setAnalog(3, 300);
+     start = ArduinoSim::now();
+     int conductivity = robot->getConductivity();
+     report("getConductivity", ArduinoSim::now() - start, "us");
+     report("getConductivity result", conductivity, "");
+
+     // Same measurement in the background while the control loop keeps running
+     robot->startConductivity();
+     loops = 0;
+     start = ArduinoSim::now();
+     while (!robot->conductivityReady())
+     {
+          robot->getBump(bumpId);
+          robot->getIncline();
+          robot->getPing(pingId);
+          loops++;
+     }
+     report("background conductivity", ArduinoSim::now() - start, "us");
+     report("background conductivity loops", loops, "");
+     report("background conductivity result", robot->conductivityResult(), "");
+     robot->stopAnalogSampling();
+
+     printf("lcd[0] \"%s\"\n", lcd.text(0).c_str());
+     printf("lcd[1] \"%s\"\n", lcd.text(1).c_str());
+
+     delete robot;
+
+     // ******************************************* //
+     // Compile-time configuration
+     // ******************************************* //
+     KNWConfig<
+         KNWPing<1, 24, 25>,
+         KNWPing<2, 34, 35>,
+         KNWBump<3, 22>,
+         KNWServo<4, 26, 90>,
+         KNWServo<5, 28, 90>,
+         KNWIncline<0>>
+         config;
+     report("default component storage",
+            KNW_MAX_PINGS * sizeof(PingSensor) + KNW_MAX_BUMPS * sizeof(Component) +
+                KNW_MAX_IR * sizeof(IRSensor) + (KNW_MAX_MOTORS + KNW_MAX_SERVOS) * sizeof(Motor),
+            "bytes");
+     report("configured component storage", sizeof(config), "bytes");
+     robot = new KNWRobot(config.storage());
+     report("configured setup", config.setup(*robot), "");
+     report("configured getPing", robot->getPing(1), "cm");
+     delete robot;
+
+     // ******************************************* //
+     // Pin reservations
+     // ******************************************* //
+     report("pin map", sizeof(PinMap), "bytes");
+     robot = new KNWRobot(0x27);
+     robot->setupPing(1, 24, 25);
+     char line1[17], line2[17];
+     robot->setupBump(9, 25);
+     robot->getPinConflict(line1, line2);
+     printf("conflict \"%s\" \"%s\"\n", line1, line2);
+     robot->setupServo(9, 41);
+     robot->getPinConflict(line1, line2);
+     printf("conflict \"%s\" \"%s\"\n", line1, line2);
+     robot->setupPing(9, 30, 24);
+     robot->getPinConflict(line1, line2);
+     printf("conflict \"%s\" \"%s\"\n", line1, line2);
+     report("half-refused ping left pin 30", robot->getPinOwner(30, 'd'), "");
+
+     // ******************************************* //
+     // LCD status display redrawn every loop
+     // ******************************************* //
+     for (int buffered = 0; buffered < 2; buffered++)
+     {
+          robot->bufferLCD(buffered);
+          ArduinoSim::clearStats();
+          for (int i = 0; i < 100; i++)
+          {
+               robot->clearLCD();
+               robot->printLCD((char *)"Dist: ");
+               robot->printLCD(40L + i / 10);
+               robot->moveCursor(0, 1);
+               robot->printLCD((char *)"Temp: ");
+               robot->printLCD(225);
+               robot->update();
+          }
+          SimStats lcdStats = ArduinoSim::stats();
+          report(buffered ? "status redraw buffered" : "status redraw",
+                 (double)(lcdStats.i2cWrites + lcdStats.i2cReads) / 100, "transactions/iter");
+          report(buffered ? "status redraw buffered bus time" : "status redraw bus time",
+                 (double)lcdStats.i2cBusUs / 100, "us/iter");
+     }
+
+     // A whole new screen: sent at once, then a few characters per update()
+     robot->bufferLCD(true);
+     robot->clearLCD();
+     robot->printLCD((char *)"Left  12  Right ");
+     robot->moveCursor(0, 1);
+     robot->printLCD((char *)"Speed 45  Arm 90");
+     start = ArduinoSim::now();
+     robot->flushLCD();
+     report("full screen flushLCD", ArduinoSim::now() - start, "us");
+     robot->clearLCD();
+     robot->printLCD((char *)"Right 21  Left  ");
+     robot->moveCursor(0, 1);
+     robot->printLCD((char *)"Speed 54  Arm 09");
+     uint64_t longest = 0;
+     loops = 0;
+     while (robot->lcdPending())
+     {
+          uint64_t before = ArduinoSim::now();
+          robot->update();
+          if (ArduinoSim::now() - before > longest)
+               longest = ArduinoSim::now() - before;
+          loops++;
+     }
+     report("full screen in the background", loops, "updates");
+     report("full screen longest update", longest, "us");
+
+     // ******************************************* //
+     // Number formatting
+     // ******************************************* //
+     const double samples[] = {3.14159, -0.256, 1.05, 99.9996, -12.0, 1e7};
+     for (unsigned int i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+     {
+          char text[FORMAT_BUFFER];
+          formatDecimal(text, samples[i], 3, 10);
+          printf("formatDecimal %-12g \"%s\"\n", samples[i], text);
+     }
+     robot->bufferLCD(false);
+     robot->moveCursor(0, 0);
+     ArduinoSim::clearStats();
+     start = ArduinoSim::now();
+     robot->printLCD(-0.256, (short)3, (short)8);
+     report("printLCD(double)", ArduinoSim::now() - start, "us");
+     report("printLCD(double) i2c transactions", ArduinoSim::stats().i2cWrites, "");
+
+     // ******************************************* //
+     // Keypad input while the control loop keeps running
+     // ******************************************* //
+     static const uint8_t keypadRows[] = {39, 41, 43, 45};
+     static const uint8_t keypadCols[] = {47, 49, 51, 53};
+     SimKeypad keypad("123A456B789C*0#D", keypadRows, keypadCols, 4, 4);
+     keypad.type("4*45#", ArduinoSim::now() + 50000);
+     robot->clearLCD();
+     robot->printLCD((char *)"Angle:");
+     robot->startKeypadInput(1, 'n', 3);
+     loops = 0;
+     start = ArduinoSim::now();
+     while (robot->keypadInputState() == KEYPAD_EDITING)
+     {
+          robot->update();
+          robot->getPing(1);
+          loops++;
+     }
+     report("keypad input loops", loops, "");
+     report("keypad input loop", (double)(ArduinoSim::now() - start) / loops, "us/iter");
+     report("keypad input result", robot->keypadInputResult(), "");
+     printf("lcd[0] \"%s\"\n", lcd.text(0).c_str());
+     printf("lcd[1] \"%s\"\n", lcd.text(1).c_str());
+
+     keypad.type("*B#", ArduinoSim::now() + 50000);
+     report("getKeypadInput", robot->getKeypadInput(), "");
+     delete robot;
+     return 0;
+}
@@ -0,0 +1,142 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  ---------------------------------
+  |   Simulated Arduino HAL       |
+  ---------------------------------
+  Arduino.h - Host-side stand-in for the Arduino core used by the MEGA 2560.
+
+  Everything here runs against the virtual clock in ArduinoSim.h, so the
+  libraries in lib/ and src/ can be compiled and exercised on a computer
+  without an arduino on the bench. Each call charges the clock a fixed cost
+  (see SimCostModel) so loop latency can be measured deterministically.
+
+  Differences from the real core worth knowing about:
+  - int is 32 bits and unsigned long is 64 bits, so micros() never rolls over.
+  - digitalPinToInterrupt(pin) returns pin: any pin can take attachInterrupt().
+  - Not __AVR__, so libraries take their portable (non-register) code paths.
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <string.h>
+#include <cstdlib>
+#include <cmath>
+#include <type_traits>
+
+#include "binary.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned int word;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+// MEGA 2560 pin layout: 54 digital pins followed by 16 analog pins
+#define NUM_DIGITAL_PINS 70
+#define NUM_ANALOG_INPUTS 16
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+#define A6 60
+#define A7 61
+#define A8 62
+#define A9 63
+#define A10 64
+#define A11 65
+#define A12 66
+#define A13 67
+#define A14 68
+#define A15 69
+
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) < NUM_DIGITAL_PINS ? (p) : NOT_AN_INTERRUPT)
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+
+// The AVR core defines min/max as macros; templates keep <algorithm> usable
+template <class T, class U>
+inline typename std::common_type<T, U>::type min(T a, U b) { return (a < b) ? a : b; }
+template <class T, class U>
+inline typename std::common_type<T, U>::type max(T a, U b) { return (a > b) ? a : b; }
+
+// Digital / analog I/O
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+void analogWrite(uint8_t pin, int val);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
+
+// Time
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Interrupts
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void interrupts(void);
+void noInterrupts(void);
+#define cli() noInterrupts()
+#define sei() interrupts()
+
+// Math helpers
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+#include "Print.h"
+#include "HardwareSerial.h"
+#include "ArduinoSim.h"
+
+#endif // Arduino_h
@@ -0,0 +1,591 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  ArduinoSim.cpp - Virtual clock, pin model and interrupt delivery for the
+  simulated HAL, plus the Arduino core functions built on top of them.
+
+  Pin model: a pin configured as OUTPUT reads back its own latch. Otherwise
+  it follows, in order of precedence, an OUTPUT pin it is switched to (see
+  setSwitch(), used for keypad matrices), a level driven on it from outside,
+  and finally its pull-up (HIGH) or LOW when floating.
+*/
+
+#include "Arduino.h"
+#include "ArduinoSim.h"
+
+#include <stdio.h>
+#include <queue>
+#include <vector>
+
+namespace
+{
+struct Event
+{
+     uint64_t time;
+     uint64_t sequence; // keeps events scheduled for the same time in FIFO order
+     std::function<void()> fn;
+};
+
+struct EventLater
+{
+     bool operator()(const Event &a, const Event &b) const
+     {
+          if (a.time != b.time)
+               return a.time > b.time;
+          return a.sequence > b.sequence;
+     }
+};
+
+struct Pin
+{
+     uint8_t mode = INPUT;
+     uint8_t latch = LOW;
+     bool driven = false;
+     uint8_t drivenLevel = LOW;
+     uint8_t lastLevel = LOW;
+     void (*isr)(void) = nullptr;
+     int isrMode = 0;
+     bool isrPending = false;
+};
+
+struct Switch
+{
+     uint8_t a;
+     uint8_t b;
+};
+
+const uint8_t MEGA_PORTB_PINS[8] = {53, 52, 51, 50, 10, 11, 12, 13};
+
+uint64_t clockUs = 0;
+uint64_t nextSequence = 0;
+std::priority_queue<Event, std::vector<Event>, EventLater> events;
+Pin pins[NUM_DIGITAL_PINS];
+std::vector<Switch> switches;
+std::vector<SimPinListener *> listeners;
+std::vector<SimI2CDevice *> i2cDevices;
+uint16_t analogValues[NUM_ANALOG_INPUTS];
+std::function<uint16_t(uint64_t)> analogSources[NUM_ANALOG_INPUTS];
+uint16_t servoPulses[NUM_DIGITAL_PINS];
+SimCostModel costModel;
+SimStats counters;
+bool interruptsEnabled = true;
+bool inIsr = false;
+unsigned long randomState = 1;
+
+bool validPin(uint8_t pin)
+{
+     return pin < NUM_DIGITAL_PINS;
+}
+
+uint8_t computeLevel(uint8_t pin)
+{
+     const Pin &p = pins[pin];
+     if (p.mode == OUTPUT)
+          return p.latch;
+     for (size_t i = 0; i < switches.size(); i++)
+     {
+          uint8_t other;
+          if (switches[i].a == pin)
+               other = switches[i].b;
+          else if (switches[i].b == pin)
+               other = switches[i].a;
+          else
+               continue;
+          if (pins[other].mode == OUTPUT)
+               return pins[other].latch;
+     }
+     if (p.driven)
+          return p.drivenLevel;
+     return p.mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+void runPendingInterrupts()
+{
+     if (!interruptsEnabled || inIsr)
+          return;
+     // An edge that arrives while a handler runs stays pending, as the AVR
+     // flag would, and is serviced as soon as the handler returns
+     bool ran = true;
+     while (ran)
+     {
+          ran = false;
+          for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++)
+          {
+               Pin &p = pins[pin];
+               if (p.isrPending && p.isr != nullptr)
+               {
+                    p.isrPending = false;
+                    inIsr = true;
+                    counters.interrupts++;
+                    p.isr();
+                    inIsr = false;
+                    clockUs += costModel.isrEntryUs;
+                    ran = true;
+               }
+          }
+     }
+}
+
+// Recomputes a pin's level and raises its interrupt if the edge matches
+void refreshPin(uint8_t pin)
+{
+     Pin &p = pins[pin];
+     uint8_t level = computeLevel(pin);
+     if (level == p.lastLevel)
+          return;
+     p.lastLevel = level;
+     if (p.isr == nullptr)
+          return;
+     if (p.isrMode == CHANGE ||
+         (p.isrMode == RISING && level == HIGH) ||
+         (p.isrMode == FALLING && level == LOW))
+     {
+          p.isrPending = true;
+          runPendingInterrupts();
+     }
+}
+
+void refreshConnected(uint8_t pin)
+{
+     refreshPin(pin);
+     for (size_t i = 0; i < switches.size(); i++)
+     {
+          if (switches[i].a == pin)
+               refreshPin(switches[i].b);
+          else if (switches[i].b == pin)
+               refreshPin(switches[i].a);
+     }
+}
+
+void notifyWrite(uint8_t pin, uint8_t level)
+{
+     for (size_t i = 0; i < listeners.size(); i++)
+          listeners[i]->pinWritten(pin, level);
+}
+
+void writeLatch(uint8_t pin, uint8_t level)
+{
+     uint8_t previous = pins[pin].latch;
+     pins[pin].latch = level ? HIGH : LOW;
+     refreshConnected(pin);
+     if (pins[pin].mode == OUTPUT && previous != pins[pin].latch)
+          notifyWrite(pin, pins[pin].latch);
+}
+} // namespace
+
+// ******************************************* //
+// Simulator controls
+// ******************************************* //
+void ArduinoSim::reset()
+{
+     clockUs = 0;
+     nextSequence = 0;
+     events = std::priority_queue<Event, std::vector<Event>, EventLater>();
+     for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++)
+          pins[pin] = Pin();
+     switches.clear();
+     listeners.clear();
+     i2cDevices.clear();
+     for (uint8_t ch = 0; ch < NUM_ANALOG_INPUTS; ch++)
+     {
+          analogValues[ch] = 0;
+          analogSources[ch] = nullptr;
+     }
+     memset(servoPulses, 0, sizeof(servoPulses));
+     costModel = SimCostModel();
+     counters = SimStats();
+     interruptsEnabled = true;
+     inIsr = false;
+     randomState = 1;
+}
+
+uint64_t ArduinoSim::now()
+{
+     return clockUs;
+}
+
+void ArduinoSim::runUntil(uint64_t timeUs)
+{
+     while (!events.empty() && events.top().time <= timeUs)
+     {
+          Event ev = events.top();
+          events.pop();
+          if (ev.time > clockUs)
+               clockUs = ev.time;
+          ev.fn();
+     }
+     if (timeUs > clockUs)
+          clockUs = timeUs;
+}
+
+void ArduinoSim::advance(uint64_t us)
+{
+     runUntil(clockUs + us);
+}
+
+SimCostModel &ArduinoSim::costs()
+{
+     return costModel;
+}
+
+void ArduinoSim::at(uint64_t timeUs, std::function<void()> fn)
+{
+     Event ev;
+     ev.time = timeUs;
+     ev.sequence = nextSequence++;
+     ev.fn = fn;
+     events.push(ev);
+}
+
+void ArduinoSim::drive(uint8_t pin, uint8_t level)
+{
+     if (!validPin(pin))
+          return;
+     pins[pin].driven = true;
+     pins[pin].drivenLevel = level ? HIGH : LOW;
+     refreshConnected(pin);
+}
+
+void ArduinoSim::driveAt(uint8_t pin, uint64_t timeUs, uint8_t level)
+{
+     at(timeUs, [pin, level]() { ArduinoSim::drive(pin, level); });
+}
+
+void ArduinoSim::release(uint8_t pin)
+{
+     if (!validPin(pin))
+          return;
+     pins[pin].driven = false;
+     refreshConnected(pin);
+}
+
+uint64_t ArduinoSim::scriptPulses(
+    uint8_t pin,
+    uint64_t startUs,
+    uint8_t idleLevel,
+    const uint32_t *durations,
+    size_t count)
+{
+     uint64_t t = startUs;
+     uint8_t level = idleLevel ? LOW : HIGH;
+     for (size_t i = 0; i < count; i++)
+     {
+          driveAt(pin, t, level);
+          t += durations[i];
+          level = level ? LOW : HIGH;
+     }
+     driveAt(pin, t, idleLevel);
+     return t;
+}
+
+void ArduinoSim::setSwitch(uint8_t pinA, uint8_t pinB, bool closed)
+{
+     for (size_t i = 0; i < switches.size(); i++)
+     {
+          if ((switches[i].a == pinA && switches[i].b == pinB) ||
+              (switches[i].a == pinB && switches[i].b == pinA))
+          {
+               if (!closed)
+                    switches.erase(switches.begin() + i);
+               refreshPin(pinA);
+               refreshPin(pinB);
+               return;
+          }
+     }
+     if (closed)
+     {
+          Switch s;
+          s.a = pinA;
+          s.b = pinB;
+          switches.push_back(s);
+     }
+     refreshPin(pinA);
+     refreshPin(pinB);
+}
+
+void ArduinoSim::setAnalog(uint8_t channel, uint16_t value)
+{
+     if (channel < NUM_ANALOG_INPUTS)
+     {
+          analogValues[channel] = value > 1023 ? 1023 : value;
+          analogSources[channel] = nullptr;
+     }
+}
+
+void ArduinoSim::setAnalogSource(uint8_t channel, std::function<uint16_t(uint64_t)> source)
+{
+     if (channel < NUM_ANALOG_INPUTS)
+          analogSources[channel] = source;
+}
+
+uint8_t ArduinoSim::level(uint8_t pin)
+{
+     return validPin(pin) ? computeLevel(pin) : LOW;
+}
+
+uint8_t ArduinoSim::outputLevel(uint8_t pin)
+{
+     return validPin(pin) ? pins[pin].latch : LOW;
+}
+
+uint8_t ArduinoSim::mode(uint8_t pin)
+{
+     return validPin(pin) ? pins[pin].mode : INPUT;
+}
+
+void ArduinoSim::addPinListener(SimPinListener *listener)
+{
+     listeners.push_back(listener);
+}
+
+void ArduinoSim::attachI2C(SimI2CDevice *device)
+{
+     detachI2C(device);
+     i2cDevices.push_back(device);
+}
+
+void ArduinoSim::detachI2C(SimI2CDevice *device)
+{
+     for (size_t i = 0; i < i2cDevices.size(); i++)
+     {
+          if (i2cDevices[i] == device)
+          {
+               i2cDevices.erase(i2cDevices.begin() + i);
+               return;
+          }
+     }
+}
+
+SimI2CDevice *ArduinoSim::findI2C(uint8_t address)
+{
+     for (size_t i = 0; i < i2cDevices.size(); i++)
+     {
+          if (i2cDevices[i]->address() == address)
+               return i2cDevices[i];
+     }
+     return nullptr;
+}
+
+void ArduinoSim::setServoPulse(uint8_t pin, uint16_t pulseUs)
+{
+     if (validPin(pin))
+          servoPulses[pin] = pulseUs;
+}
+
+uint16_t ArduinoSim::servoPulse(uint8_t pin)
+{
+     return validPin(pin) ? servoPulses[pin] : 0;
+}
+
+SimStats &ArduinoSim::stats()
+{
+     return counters;
+}
+
+void ArduinoSim::clearStats()
+{
+     counters = SimStats();
+}
+
+// ******************************************* //
+// Port registers
+// ******************************************* //
+SimPort PORTB(MEGA_PORTB_PINS);
+
+SimPort::operator uint8_t() const
+{
+     uint8_t value = 0;
+     for (uint8_t bit = 0; bit < 8; bit++)
+     {
+          if (pins[pinMap[bit]].latch)
+               value |= (1 << bit);
+     }
+     return value;
+}
+
+SimPort &SimPort::operator=(uint8_t value)
+{
+     for (uint8_t bit = 0; bit < 8; bit++)
+          writeLatch(pinMap[bit], (value >> bit) & 0x01);
+     return *this;
+}
+
+// ******************************************* //
+// Arduino core: digital / analog I/O
+// ******************************************* //
+void pinMode(uint8_t pin, uint8_t mode)
+{
+     ArduinoSim::advance(costModel.pinModeUs);
+     if (!validPin(pin))
+          return;
+     pins[pin].mode = mode;
+     if (mode == INPUT_PULLUP)
+          pins[pin].latch = HIGH;
+     else if (mode == INPUT)
+          pins[pin].latch = LOW;
+     refreshConnected(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+     ArduinoSim::advance(costModel.digitalWriteUs);
+     counters.digitalWrites++;
+     if (validPin(pin))
+          writeLatch(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+     ArduinoSim::advance(costModel.digitalReadUs);
+     counters.digitalReads++;
+     return validPin(pin) ? computeLevel(pin) : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+     ArduinoSim::advance(costModel.analogReadUs);
+     counters.analogReads++;
+     uint8_t channel = pin >= A0 ? pin - A0 : pin;
+     if (channel >= NUM_ANALOG_INPUTS)
+          return 0;
+     if (analogSources[channel])
+     {
+          uint16_t value = analogSources[channel](clockUs);
+          return value > 1023 ? 1023 : value;
+     }
+     return analogValues[channel];
+}
+
+void analogReference(uint8_t)
+{
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+     pinMode(pin, OUTPUT);
+     digitalWrite(pin, val >= 128 ? HIGH : LOW);
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
+{
+     uint64_t start = clockUs;
+     while (digitalRead(pin) == state)
+          if (clockUs - start >= timeout)
+               return 0;
+     while (digitalRead(pin) != state)
+          if (clockUs - start >= timeout)
+               return 0;
+     uint64_t pulseStart = clockUs;
+     while (digitalRead(pin) == state)
+          if (clockUs - start >= timeout)
+               return 0;
+     return (unsigned long)(clockUs - pulseStart);
+}
+
+// ******************************************* //
+// Arduino core: time
+// ******************************************* //
+unsigned long micros(void)
+{
+     ArduinoSim::advance(costModel.clockReadUs);
+     counters.clockReads++;
+     return (unsigned long)clockUs;
+}
+
+unsigned long millis(void)
+{
+     ArduinoSim::advance(costModel.clockReadUs);
+     counters.clockReads++;
+     return (unsigned long)(clockUs / 1000);
+}
+
+void delay(unsigned long ms)
+{
+     counters.delayUs += (uint64_t)ms * 1000;
+     ArduinoSim::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+     counters.delayUs += us;
+     ArduinoSim::advance(us);
+}
+
+// ******************************************* //
+// Arduino core: interrupts
+// ******************************************* //
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+     if (!validPin(interruptNum))
+          return;
+     Pin &p = pins[interruptNum];
+     p.isr = userFunc;
+     p.isrMode = mode;
+     p.isrPending = false;
+     p.lastLevel = computeLevel(interruptNum);
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+     if (!validPin(interruptNum))
+          return;
+     pins[interruptNum].isr = nullptr;
+     pins[interruptNum].isrPending = false;
+}
+
+void interrupts(void)
+{
+     interruptsEnabled = true;
+     runPendingInterrupts();
+}
+
+void noInterrupts(void)
+{
+     interruptsEnabled = false;
+}
+
+// ******************************************* //
+// Arduino core: math
+// ******************************************* //
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+long random(long howbig)
+{
+     if (howbig == 0)
+          return 0;
+     // Plain LCG so a seeded run always produces the same sequence
+     randomState = (randomState * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+     return (long)(randomState % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+     if (howsmall >= howbig)
+          return howsmall;
+     return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+     if (seed != 0)
+          randomState = seed;
+}
+
+// ******************************************* //
+// Serial
+// ******************************************* //
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c)
+{
+     putchar(c);
+     return 1;
+}
+
+void HardwareSerial::flush(void)
+{
+     fflush(stdout);
+}
@@ -0,0 +1,172 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  ---------------------------------
+  |   Simulated Arduino HAL       |
+  ---------------------------------
+  ArduinoSim.h - Controls for the host-side simulator behind Arduino.h.
+
+  The simulator owns a virtual microsecond clock. Nothing advances it except
+  HAL calls: every digitalRead(), analogRead(), micros(), I2C byte, etc.
+  charges the clock a fixed cost taken from SimCostModel, and delay() simply
+  moves it forward. Pin waveforms and callbacks are scheduled against the
+  same clock and fire, in time order, whenever it passes them. Two runs of
+  the same program therefore produce identical timings and bus traffic.
+
+  Typical use from a host program:
+
+  @code
+  ArduinoSim::reset();
+  SimPCA9685 pca(0x40);
+  ArduinoSim::attachI2C(&pca);
+  ArduinoSim::driveAt(7, 5000, HIGH); // bump sensor closes 5ms in
+
+  uint64_t start = ArduinoSim::now();
+  robot->getBump(7);
+  uint64_t elapsed = ArduinoSim::now() - start;
+  @endcode
+*/
+
+#ifndef ArduinoSim_h
+#define ArduinoSim_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+/**
+ * How long (in virtual microseconds) each HAL operation takes. The defaults
+ * approximate a 16MHz MEGA 2560 running the stock Arduino core.
+ */
+struct SimCostModel
+{
+     unsigned int digitalReadUs = 4;
+     unsigned int digitalWriteUs = 4;
+     unsigned int pinModeUs = 4;
+     unsigned int analogReadUs = 112;
+     unsigned int clockReadUs = 4;    // micros() / millis()
+     unsigned int isrEntryUs = 4;     // prologue + epilogue of an interrupt handler
+     unsigned int eepromWriteUs = 3300;
+     unsigned long i2cClockHz = 100000;
+};
+
+/**
+ * Counters for everything the simulated program did. Cleared by
+ * ArduinoSim::reset() or ArduinoSim::clearStats().
+ */
+struct SimStats
+{
+     unsigned long digitalReads = 0;
+     unsigned long digitalWrites = 0;
+     unsigned long analogReads = 0;
+     unsigned long clockReads = 0;
+     uint64_t delayUs = 0;            // time spent inside delay()/delayMicroseconds()
+     unsigned long interrupts = 0;    // ISR invocations
+     unsigned long i2cWrites = 0;     // beginTransmission/endTransmission pairs
+     unsigned long i2cReads = 0;      // requestFrom() calls
+     unsigned long i2cBytes = 0;      // payload bytes in either direction
+     unsigned long i2cNacks = 0;      // transactions nobody answered
+     uint64_t i2cBusUs = 0;           // time the bus was busy
+     unsigned long eepromWrites = 0;
+};
+
+/**
+ * Something that wants to know when the program drives a pin, e.g. an
+ * ultrasonic sensor model watching its trigger line.
+ */
+class SimPinListener
+{
+public:
+     virtual ~SimPinListener() {}
+     virtual void pinWritten(uint8_t pin, uint8_t level) = 0;
+};
+
+/**
+ * A device on the simulated I2C bus. receive() gets the bytes of one write
+ * transaction; transmit() fills the buffer for a read transaction and returns
+ * how many bytes the device supplied.
+ */
+class SimI2CDevice
+{
+public:
+     explicit SimI2CDevice(uint8_t address) : i2cAddress(address) {}
+     virtual ~SimI2CDevice() {}
+     uint8_t address() const { return i2cAddress; }
+     virtual void receive(const uint8_t *data, size_t length) = 0;
+     virtual size_t transmit(uint8_t *data, size_t length) = 0;
+
+private:
+     uint8_t i2cAddress;
+};
+
+/**
+ * An 8-bit I/O port register such as PORTB. Writing it sets the output
+ * latches of the pins it maps to, just like on the AVR.
+ */
+class SimPort
+{
+public:
+     explicit SimPort(const uint8_t *pins) : pinMap(pins) {}
+     operator uint8_t() const;
+     SimPort &operator=(uint8_t value);
+     SimPort &operator|=(uint8_t value) { return *this = (uint8_t)(*this | value); }
+     SimPort &operator&=(uint8_t value) { return *this = (uint8_t)(*this & value); }
+     SimPort &operator^=(uint8_t value) { return *this = (uint8_t)(*this ^ value); }
+
+private:
+     const uint8_t *pinMap; // arduino pin for bit 0..7
+};
+
+extern SimPort PORTB;
+
+class ArduinoSim
+{
+public:
+     // Puts the simulator back to power-on state: clock at 0, pins floating,
+     // no scheduled events, no devices on the bus, counters cleared.
+     static void reset();
+
+     // Virtual clock
+     static uint64_t now();
+     static void advance(uint64_t us);
+     static void runUntil(uint64_t timeUs);
+     static SimCostModel &costs();
+
+     // Calls fn once the clock reaches timeUs
+     static void at(uint64_t timeUs, std::function<void()> fn);
+
+     // External signals applied to pins
+     static void drive(uint8_t pin, uint8_t level);
+     static void driveAt(uint8_t pin, uint64_t timeUs, uint8_t level);
+     static void release(uint8_t pin);
+     static uint64_t scriptPulses(
+         uint8_t pin,
+         uint64_t startUs,
+         uint8_t idleLevel,
+         const uint32_t *durations,
+         size_t count);
+     static void setSwitch(uint8_t pinA, uint8_t pinB, bool closed);
+     static void setAnalog(uint8_t channel, uint16_t value);
+     static void setAnalogSource(uint8_t channel, std::function<uint16_t(uint64_t)> source);
+
+     // What the program is doing with its pins
+     static uint8_t level(uint8_t pin);
+     static uint8_t outputLevel(uint8_t pin);
+     static uint8_t mode(uint8_t pin);
+     static void addPinListener(SimPinListener *listener);
+
+     // Devices
+     static void attachI2C(SimI2CDevice *device);
+     static void detachI2C(SimI2CDevice *device);
+     static SimI2CDevice *findI2C(uint8_t address);
+     static void setEepromFile(const char *path);
+
+     // Pulse width (us) the Servo library is generating on a pin, 0 if none
+     static void setServoPulse(uint8_t pin, uint16_t pulseUs);
+     static uint16_t servoPulse(uint8_t pin);
+
+     static SimStats &stats();
+     static void clearStats();
+};
+
+#endif // ArduinoSim_h
@@ -0,0 +1,114 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  EEPROM.cpp - File-backed EEPROM for the simulated HAL. Erased cells read
+  0xFF. Out-of-range addresses read 0xFF and ignore writes.
+*/
+
+#include "Arduino.h"
+#include "ArduinoSim.h"
+#include "EEPROM.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+namespace
+{
+uint8_t cells[E2END + 1];
+bool loaded = false;
+std::string backingFile;
+
+void load()
+{
+     if (loaded)
+          return;
+     loaded = true;
+     memset(cells, 0xFF, sizeof(cells));
+     if (backingFile.empty())
+     {
+          const char *env = getenv("KNW_SIM_EEPROM");
+          if (env != nullptr)
+               backingFile = env;
+     }
+     if (backingFile.empty())
+          return;
+     FILE *f = fopen(backingFile.c_str(), "rb");
+     if (f == nullptr)
+          return;
+     size_t got = fread(cells, 1, sizeof(cells), f);
+     (void)got;
+     fclose(f);
+}
+
+void store(int idx)
+{
+     if (backingFile.empty())
+          return;
+     FILE *f = fopen(backingFile.c_str(), "r+b");
+     if (f == nullptr)
+     {
+          // First write creates the file with the whole (erased) image
+          f = fopen(backingFile.c_str(), "wb");
+          if (f == nullptr)
+               return;
+          fwrite(cells, 1, sizeof(cells), f);
+          fclose(f);
+          return;
+     }
+     fseek(f, idx, SEEK_SET);
+     fputc(cells[idx], f);
+     fclose(f);
+}
+} // namespace
+
+void ArduinoSim::setEepromFile(const char *path)
+{
+     backingFile = path != nullptr ? path : "";
+     loaded = false;
+     load();
+}
+
+uint8_t EEPROMClass::read(int idx)
+{
+     load();
+     if (idx < 0 || idx > E2END)
+          return 0xFF;
+     return cells[idx];
+}
+
+void EEPROMClass::write(int idx, uint8_t val)
+{
+     load();
+     if (idx < 0 || idx > E2END)
+          return;
+     ArduinoSim::advance(ArduinoSim::costs().eepromWriteUs);
+     ArduinoSim::stats().eepromWrites++;
+     cells[idx] = val;
+     store(idx);
+}
+
+void EEPROMClass::update(int idx, uint8_t val)
+{
+     if (read(idx) != val)
+          write(idx, val);
+}
+
+uint8_t EERef::operator*() const
+{
+     return EEPROM.read(index);
+}
+
+EERef &EERef::operator=(uint8_t value)
+{
+     EEPROM.write(index, value);
+     return *this;
+}
+
+EERef &EERef::update(uint8_t value)
+{
+     EEPROM.update(index, value);
+     return *this;
+}
+
+EEPROMClass EEPROM;
@@ -0,0 +1,65 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  EEPROM.h - 4KB MEGA 2560 EEPROM on the simulated HAL. Contents live in
+  memory and, when a backing file is configured (ArduinoSim::setEepromFile()
+  or the KNW_SIM_EEPROM environment variable), are loaded from and written
+  through to that file so they survive between runs. Every byte actually
+  written charges SimCostModel::eepromWriteUs, like the real 3.3ms cell write.
+*/
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define E2END 0xFFF
+
+class EEPROMClass;
+
+// Reference to a single EEPROM cell, so EEPROM[i] can be read and assigned
+struct EERef
+{
+     EERef(int index) : index(index) {}
+
+     uint8_t operator*() const;
+     operator uint8_t() const { return **this; }
+     EERef &operator=(uint8_t value);
+     EERef &operator=(const EERef &ref) { return *this = *ref; }
+     EERef &update(uint8_t value);
+
+     int index;
+};
+
+class EEPROMClass
+{
+public:
+     uint8_t read(int idx);
+     void write(int idx, uint8_t val);
+     void update(int idx, uint8_t val);
+     EERef operator[](int idx) { return EERef(idx); }
+     uint16_t length() { return E2END + 1; }
+
+     template <typename T>
+     T &get(int idx, T &t)
+     {
+          uint8_t *ptr = (uint8_t *)&t;
+          for (size_t i = 0; i < sizeof(T); i++)
+               ptr[i] = read(idx + i);
+          return t;
+     }
+
+     template <typename T>
+     const T &put(int idx, const T &t)
+     {
+          const uint8_t *ptr = (const uint8_t *)&t;
+          for (size_t i = 0; i < sizeof(T); i++)
+               update(idx + i, ptr[i]);
+          return t;
+     }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // EEPROM_h
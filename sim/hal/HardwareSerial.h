@@ -0,0 +1,29 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  HardwareSerial.h - Serial on the simulated HAL writes straight to stdout.
+  Nothing is ever received, so available() is always 0.
+*/
+
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Print.h"
+
+class HardwareSerial : public Print
+{
+public:
+     void begin(unsigned long) {}
+     void end() {}
+     int available(void) { return 0; }
+     int peek(void) { return -1; }
+     int read(void) { return -1; }
+     void flush(void);
+     size_t write(uint8_t c);
+     using Print::write;
+     operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HardwareSerial_h
@@ -0,0 +1,66 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  Print.h - Host-side copy of the Arduino Print base class. LCD and
+  HardwareSerial derive from it, so the print() overloads behave (and format
+  numbers) exactly like they do on the arduino.
+*/
+
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class Print
+{
+public:
+     Print() : write_error(0) {}
+     virtual ~Print() {}
+
+     int getWriteError() { return write_error; }
+     void clearWriteError() { write_error = 0; }
+
+     virtual size_t write(uint8_t) = 0;
+     size_t write(const char *str)
+     {
+          if (str == NULL)
+               return 0;
+          return write((const uint8_t *)str, strlen(str));
+     }
+     virtual size_t write(const uint8_t *buffer, size_t size);
+     size_t write(const char *buffer, size_t size)
+     {
+          return write((const uint8_t *)buffer, size);
+     }
+
+     size_t print(const char[]);
+     size_t print(char);
+     size_t print(unsigned char, int = 10);
+     size_t print(int, int = 10);
+     size_t print(unsigned int, int = 10);
+     size_t print(long, int = 10);
+     size_t print(unsigned long, int = 10);
+     size_t print(double, int = 2);
+
+     size_t println(const char[]);
+     size_t println(char);
+     size_t println(unsigned char, int = 10);
+     size_t println(int, int = 10);
+     size_t println(unsigned int, int = 10);
+     size_t println(long, int = 10);
+     size_t println(unsigned long, int = 10);
+     size_t println(double, int = 2);
+     size_t println(void);
+
+protected:
+     void setWriteError(int err = 1) { write_error = err; }
+
+private:
+     int write_error;
+     size_t printNumber(unsigned long, uint8_t);
+     size_t printFloat(double, uint8_t);
+};
+
+#endif // Print_h
@@ -0,0 +1,95 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  Servo.cpp - Servo library on the simulated HAL. No waveform is generated;
+  the commanded pulse width is published through ArduinoSim::setServoPulse().
+*/
+
+#include "Arduino.h"
+#include "ArduinoSim.h"
+#include "Servo.h"
+
+static uint8_t servoCount = 0;
+
+Servo::Servo()
+{
+     servoPin = -1;
+     minPulse = MIN_PULSE_WIDTH;
+     maxPulse = MAX_PULSE_WIDTH;
+     pulseUs = DEFAULT_PULSE_WIDTH;
+}
+
+uint8_t Servo::attach(int pin)
+{
+     return attach(pin, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+}
+
+uint8_t Servo::attach(int pin, int min, int max)
+{
+     if (!attached())
+     {
+          if (servoCount >= MAX_SERVOS)
+               return INVALID_SERVO;
+          servoCount++;
+     }
+     pinMode(pin, OUTPUT);
+     servoPin = pin;
+     minPulse = min;
+     maxPulse = max;
+     ArduinoSim::setServoPulse(servoPin, pulseUs);
+     return servoCount - 1;
+}
+
+void Servo::detach()
+{
+     if (!attached())
+          return;
+     ArduinoSim::setServoPulse(servoPin, 0);
+     servoPin = -1;
+     servoCount--;
+}
+
+void Servo::write(int value)
+{
+     // Values below the minimum pulse width are angles, as in the AVR library
+     if (value < MIN_PULSE_WIDTH)
+     {
+          if (value < 0)
+               value = 0;
+          if (value > 180)
+               value = 180;
+          value = map(value, 0, 180, minPulse, maxPulse);
+     }
+     writeMicroseconds(value);
+}
+
+void Servo::writeMicroseconds(int value)
+{
+     if (value < minPulse)
+          value = minPulse;
+     else if (value > maxPulse)
+          value = maxPulse;
+     pulseUs = value;
+     if (attached())
+          ArduinoSim::setServoPulse(servoPin, pulseUs);
+}
+
+int Servo::read()
+{
+     return map(readMicroseconds() + 1, minPulse, maxPulse, 0, 180);
+}
+
+int Servo::readMicroseconds()
+{
+     return pulseUs;
+}
+
+bool Servo::attached()
+{
+     return servoPin >= 0;
+}
+
+uint8_t Servo::attachedCount()
+{
+     return servoCount;
+}
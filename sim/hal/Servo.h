@@ -0,0 +1,44 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  Servo.h - Servo library on the simulated HAL. The pulse width each servo
+  is commanded to is recorded per pin and can be read back with
+  ArduinoSim::servoPulse(). Limits and angle mapping match the AVR library.
+*/
+
+#ifndef Servo_h
+#define Servo_h
+
+#include <inttypes.h>
+
+#define MIN_PULSE_WIDTH 544
+#define MAX_PULSE_WIDTH 2400
+#define DEFAULT_PULSE_WIDTH 1500
+#define REFRESH_INTERVAL 20000
+#define MAX_SERVOS 48
+#define INVALID_SERVO 255
+
+class Servo
+{
+public:
+     Servo();
+     uint8_t attach(int pin);
+     uint8_t attach(int pin, int min, int max);
+     void detach();
+     void write(int value);
+     void writeMicroseconds(int value);
+     int read();
+     int readMicroseconds();
+     bool attached();
+
+     // Number of servos currently attached across all instances
+     static uint8_t attachedCount();
+
+private:
+     int servoPin;
+     int minPulse;
+     int maxPulse;
+     int pulseUs;
+};
+
+#endif // Servo_h
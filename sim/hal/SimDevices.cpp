@@ -0,0 +1,386 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  SimDevices.cpp - Device models for the simulated HAL. Only the behaviour
+  the KNW libraries rely on is modelled; see the datasheets for the rest.
+*/
+
+#include "Arduino.h"
+#include "SimDevices.h"
+
+// PCA9685 registers
+#define PCA_MODE1 0x00
+#define PCA_MODE2 0x01
+#define PCA_LED0_ON_L 0x06
+#define PCA_ALL_LED_ON_L 0xFA
+#define PCA_PRESCALE 0xFE
+#define PCA_MODE1_AI 0x20
+#define PCA_MODE1_SLEEP 0x10
+#define PCA_MODE1_RESTART 0x80
+
+// HD44780 instructions
+#define LCD_CLEAR 0x01
+#define LCD_HOME 0x02
+#define LCD_ENTRY_MODE 0x04
+#define LCD_DISPLAY_CONTROL 0x08
+#define LCD_SHIFT 0x10
+#define LCD_FUNCTION_SET 0x20
+#define LCD_SET_CGRAM 0x40
+#define LCD_SET_DDRAM 0x80
+
+// NEC timings (us)
+#define NEC_LEADER_MARK 9000
+#define NEC_LEADER_SPACE 4500
+#define NEC_BIT_MARK 562
+#define NEC_ZERO_SPACE 562
+#define NEC_ONE_SPACE 1687
+
+// HC-SR04: delay before the echo starts, and echo length with no target
+#define PING_START_DELAY 450
+#define PING_NO_ECHO_US 38000
+#define PING_US_PER_CM 57
+
+// ******************************************* //
+// SimPCA9685
+// ******************************************* //
+SimPCA9685::SimPCA9685(uint8_t address) : SimI2CDevice(address)
+{
+     memset(regs, 0, sizeof(regs));
+     regs[PCA_MODE1] = 0x11; // asleep, responds to ALLCALL
+     regs[PCA_MODE2] = 0x04;
+     regs[PCA_PRESCALE] = 0x1E;
+     pointer = 0;
+     writes = 0;
+}
+
+void SimPCA9685::advancePointer()
+{
+     if (!(regs[PCA_MODE1] & PCA_MODE1_AI))
+          return;
+     // Auto-increment runs through the LED registers and wraps back to MODE1
+     pointer++;
+     if (pointer == PCA_ALL_LED_ON_L)
+          pointer = 0;
+}
+
+void SimPCA9685::writeRegister(uint8_t index, uint8_t value)
+{
+     writes++;
+     if (index == PCA_MODE1)
+     {
+          regs[PCA_MODE1] = value & ~PCA_MODE1_RESTART;
+     }
+     else if (index == PCA_PRESCALE)
+     {
+          // PRESCALE only latches while the oscillator is off
+          if (regs[PCA_MODE1] & PCA_MODE1_SLEEP)
+               regs[PCA_PRESCALE] = value < 3 ? 3 : value;
+     }
+     else if (index >= PCA_ALL_LED_ON_L && index < PCA_PRESCALE)
+     {
+          regs[index] = value;
+          for (uint8_t ch = 0; ch < 16; ch++)
+               regs[PCA_LED0_ON_L + 4 * ch + (index - PCA_ALL_LED_ON_L)] = value;
+     }
+     else
+     {
+          regs[index] = value;
+     }
+}
+
+void SimPCA9685::receive(const uint8_t *data, size_t length)
+{
+     if (length == 0)
+          return;
+     pointer = data[0];
+     for (size_t i = 1; i < length; i++)
+     {
+          writeRegister(pointer, data[i]);
+          advancePointer();
+     }
+}
+
+size_t SimPCA9685::transmit(uint8_t *data, size_t length)
+{
+     for (size_t i = 0; i < length; i++)
+     {
+          data[i] = regs[pointer];
+          advancePointer();
+     }
+     return length;
+}
+
+uint16_t SimPCA9685::on(uint8_t channel) const
+{
+     uint8_t base = PCA_LED0_ON_L + 4 * (channel & 0x0F);
+     return regs[base] | ((regs[base + 1] & 0x1F) << 8);
+}
+
+uint16_t SimPCA9685::off(uint8_t channel) const
+{
+     uint8_t base = PCA_LED0_ON_L + 4 * (channel & 0x0F) + 2;
+     return regs[base] | ((regs[base + 1] & 0x1F) << 8);
+}
+
+// ******************************************* //
+// SimPCF8574
+// ******************************************* //
+SimPCF8574::SimPCF8574(uint8_t address) : SimI2CDevice(address)
+{
+     output = 0xFF;
+     inputs = 0xFF;
+}
+
+void SimPCF8574::receive(const uint8_t *data, size_t length)
+{
+     for (size_t i = 0; i < length; i++)
+     {
+          uint8_t previous = output;
+          output = data[i];
+          portWritten(previous, output);
+     }
+}
+
+size_t SimPCF8574::transmit(uint8_t *data, size_t length)
+{
+     // A pin reads low if either side pulls it low
+     for (size_t i = 0; i < length; i++)
+          data[i] = output & inputs;
+     return length;
+}
+
+void SimPCF8574::portWritten(uint8_t, uint8_t)
+{
+}
+
+// ******************************************* //
+// SimLCD1602
+// ******************************************* //
+SimLCD1602::SimLCD1602(
+    uint8_t address,
+    uint8_t en,
+    uint8_t rw,
+    uint8_t rs,
+    uint8_t d4,
+    uint8_t backlight)
+    : SimPCF8574(address)
+{
+     enBit = en;
+     rwBit = rw;
+     rsBit = rs;
+     d4Bit = d4;
+     lightBit = backlight;
+
+     // Power-on state: 8-bit interface, blank display
+     fourBit = false;
+     haveHighNibble = false;
+     highNibble = 0;
+     cgram = false;
+     memset(ddram, ' ', sizeof(ddram));
+     address = 0;
+     increment = true;
+     display = false;
+     light = false;
+     commandCount = 0;
+     dataCount = 0;
+}
+
+void SimLCD1602::portWritten(uint8_t previous, uint8_t value)
+{
+     light = (value >> lightBit) & 0x01;
+
+     // The controller samples the bus on the falling edge of E
+     bool enFell = ((previous >> enBit) & 0x01) && !((value >> enBit) & 0x01);
+     if (!enFell || ((previous >> rwBit) & 0x01))
+          return;
+
+     uint8_t nibble = (previous >> d4Bit) & 0x0F;
+     bool isData = (previous >> rsBit) & 0x01;
+
+     if (!fourBit)
+     {
+          // Only D4..D7 are wired, so D0..D3 read as 0 in 8-bit mode
+          execute(nibble << 4, isData);
+          return;
+     }
+     if (!haveHighNibble)
+     {
+          highNibble = nibble;
+          haveHighNibble = true;
+          return;
+     }
+     haveHighNibble = false;
+     execute((highNibble << 4) | nibble, isData);
+}
+
+void SimLCD1602::execute(uint8_t value, bool isData)
+{
+     if (isData)
+     {
+          dataCount++;
+          if (cgram)
+               return;
+          ddram[address] = value;
+          address = (increment ? address + 1 : address - 1) & 0x7F;
+          return;
+     }
+
+     commandCount++;
+     if (value & LCD_SET_DDRAM)
+     {
+          address = value & 0x7F;
+          cgram = false;
+     }
+     else if (value & LCD_SET_CGRAM)
+     {
+          cgram = true;
+     }
+     else if (value & LCD_FUNCTION_SET)
+     {
+          if (!fourBit && !(value & 0x10))
+          {
+               fourBit = true;
+               haveHighNibble = false;
+          }
+     }
+     else if (value & LCD_SHIFT)
+     {
+          if (!(value & 0x08))
+               address = ((value & 0x04) ? address + 1 : address - 1) & 0x7F;
+     }
+     else if (value & LCD_DISPLAY_CONTROL)
+     {
+          display = value & 0x04;
+     }
+     else if (value & LCD_ENTRY_MODE)
+     {
+          increment = value & 0x02;
+     }
+     else if (value & LCD_HOME)
+     {
+          address = 0;
+          cgram = false;
+     }
+     else if (value & LCD_CLEAR)
+     {
+          memset(ddram, ' ', sizeof(ddram));
+          address = 0;
+          increment = true;
+          cgram = false;
+     }
+}
+
+std::string SimLCD1602::text(uint8_t row) const
+{
+     uint8_t start = row ? 0x40 : 0x00;
+     return std::string((const char *)ddram + start, 16);
+}
+
+// ******************************************* //
+// SimUltrasonic
+// ******************************************* //
+SimUltrasonic::SimUltrasonic(uint8_t trigger, uint8_t echo)
+{
+     triggerPin = trigger;
+     echoPin = echo;
+     distanceCm = 0;
+     pingCount = 0;
+     ArduinoSim::drive(echoPin, LOW);
+     ArduinoSim::addPinListener(this);
+}
+
+void SimUltrasonic::pinWritten(uint8_t pin, uint8_t level)
+{
+     // A ping starts on the falling edge of the trigger pulse
+     if (pin != triggerPin || level != LOW)
+          return;
+     pingCount++;
+     uint64_t start = ArduinoSim::now() + PING_START_DELAY;
+     uint64_t width = distanceCm ? (uint64_t)distanceCm * PING_US_PER_CM : PING_NO_ECHO_US;
+     ArduinoSim::driveAt(echoPin, start, HIGH);
+     ArduinoSim::driveAt(echoPin, start + width, LOW);
+}
+
+// ******************************************* //
+// SimIRBeacon
+// ******************************************* //
+SimIRBeacon::SimIRBeacon(uint8_t pin)
+{
+     receiverPin = pin;
+     ArduinoSim::drive(receiverPin, HIGH);
+}
+
+uint64_t SimIRBeacon::send(uint64_t startUs, uint8_t value)
+{
+     // Leader, 8 data bits MSB first, then a closing mark so the last
+     // space has an edge to end on
+     uint32_t durations[2 + 8 * 2 + 1];
+     size_t n = 0;
+     durations[n++] = NEC_LEADER_MARK;
+     durations[n++] = NEC_LEADER_SPACE;
+     for (uint8_t mask = 0x80; mask != 0; mask >>= 1)
+     {
+          durations[n++] = NEC_BIT_MARK;
+          durations[n++] = (value & mask) ? NEC_ONE_SPACE : NEC_ZERO_SPACE;
+     }
+     durations[n++] = NEC_BIT_MARK;
+     return ArduinoSim::scriptPulses(receiverPin, startUs, HIGH, durations, n);
+}
+
+uint64_t SimIRBeacon::send(uint64_t startUs, const char *text, uint32_t gapUs)
+{
+     uint64_t t = startUs;
+     for (const char *c = text; *c != '\0'; c++)
+     {
+          t = send(t, (uint8_t)*c);
+          if (c[1] != '\0')
+               t += gapUs;
+     }
+     return t;
+}
+
+// ******************************************* //
+// SimKeypad
+// ******************************************* //
+SimKeypad::SimKeypad(
+    const char *keys,
+    const uint8_t *rowPins,
+    const uint8_t *colPins,
+    uint8_t rows,
+    uint8_t cols)
+{
+     keymap = keys;
+     this->rowPins = rowPins;
+     this->colPins = colPins;
+     numRows = rows;
+     numCols = cols;
+}
+
+bool SimKeypad::press(char key, uint64_t atUs, uint32_t holdUs)
+{
+     for (uint8_t r = 0; r < numRows; r++)
+     {
+          for (uint8_t c = 0; c < numCols; c++)
+          {
+               if (keymap[r * numCols + c] != key)
+                    continue;
+               uint8_t row = rowPins[r];
+               uint8_t col = colPins[c];
+               ArduinoSim::at(atUs, [row, col]() { ArduinoSim::setSwitch(row, col, true); });
+               ArduinoSim::at(atUs + holdUs, [row, col]() { ArduinoSim::setSwitch(row, col, false); });
+               return true;
+          }
+     }
+     return false;
+}
+
+uint64_t SimKeypad::type(const char *keys, uint64_t startUs, uint32_t intervalUs)
+{
+     uint64_t t = startUs;
+     for (const char *k = keys; *k != '\0'; k++)
+     {
+          press(*k, t, intervalUs / 2);
+          t += intervalUs;
+     }
+     return t;
+}
@@ -0,0 +1,167 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  SimDevices.h - Models of the parts the KNW robot kit plugs into the MEGA,
+  for use with the simulated HAL.
+
+  - SimPCA9685:    16-channel PWM driver (I2C register file)
+  - SimPCF8574:    8-bit I2C port expander
+  - SimLCD1602:    16x2 HD44780 LCD behind a PCF8574 backpack
+  - SimUltrasonic: HC-SR04 style ping sensor answering on an echo pin
+  - SimIRBeacon:   NEC-encoded beacon feeding an IR receiver output
+  - SimKeypad:     membrane keypad as a matrix of switches
+*/
+
+#ifndef SimDevices_h
+#define SimDevices_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "ArduinoSim.h"
+
+class SimPCA9685 : public SimI2CDevice
+{
+public:
+     explicit SimPCA9685(uint8_t address = 0x40);
+     virtual void receive(const uint8_t *data, size_t length);
+     virtual size_t transmit(uint8_t *data, size_t length);
+
+     uint8_t reg(uint8_t index) const { return regs[index]; }
+     uint16_t on(uint8_t channel) const;
+     uint16_t off(uint8_t channel) const;
+     uint8_t prescale() const { return regs[0xFE]; }
+     unsigned long registerWrites() const { return writes; }
+
+private:
+     uint8_t regs[256];
+     uint8_t pointer;
+     unsigned long writes;
+
+     void writeRegister(uint8_t index, uint8_t value);
+     void advancePointer();
+};
+
+class SimPCF8574 : public SimI2CDevice
+{
+public:
+     explicit SimPCF8574(uint8_t address = 0x20);
+     virtual void receive(const uint8_t *data, size_t length);
+     virtual size_t transmit(uint8_t *data, size_t length);
+
+     uint8_t port() const { return output; }
+     // Levels external hardware pulls the quasi-bidirectional pins to
+     void setInputs(uint8_t levels) { inputs = levels; }
+
+protected:
+     // Called for every byte latched onto the port
+     virtual void portWritten(uint8_t previous, uint8_t value);
+
+private:
+     uint8_t output;
+     uint8_t inputs;
+};
+
+class SimLCD1602 : public SimPCF8574
+{
+public:
+     // Bit positions on the expander; defaults match the KNW backpack wiring
+     explicit SimLCD1602(
+         uint8_t address = 0x27,
+         uint8_t en = 2,
+         uint8_t rw = 1,
+         uint8_t rs = 0,
+         uint8_t d4 = 4,
+         uint8_t backlight = 3);
+
+     // The 16 visible characters of a row
+     std::string text(uint8_t row) const;
+     uint8_t cursor() const { return address; }
+     bool backlightOn() const { return light; }
+     bool displayOn() const { return display; }
+     unsigned long commands() const { return commandCount; }
+     unsigned long characters() const { return dataCount; }
+
+protected:
+     virtual void portWritten(uint8_t previous, uint8_t value);
+
+private:
+     uint8_t enBit;
+     uint8_t rwBit;
+     uint8_t rsBit;
+     uint8_t d4Bit;
+     uint8_t lightBit;
+
+     bool fourBit;
+     bool haveHighNibble;
+     uint8_t highNibble;
+     bool cgram; // data writes go to character generator RAM, not DDRAM
+     uint8_t ddram[0x80];
+     uint8_t address;
+     bool increment;
+     bool display;
+     bool light;
+     unsigned long commandCount;
+     unsigned long dataCount;
+
+     void execute(uint8_t value, bool isData);
+};
+
+class SimUltrasonic : public SimPinListener
+{
+public:
+     // Registers itself as a pin listener; the object must outlive the run
+     SimUltrasonic(uint8_t trigger, uint8_t echo);
+     virtual void pinWritten(uint8_t pin, uint8_t level);
+
+     // 0 means nothing in range: the sensor times out with a ~38ms echo
+     void setDistance(unsigned int cm) { distanceCm = cm; }
+     unsigned long pings() const { return pingCount; }
+
+private:
+     uint8_t triggerPin;
+     uint8_t echoPin;
+     unsigned int distanceCm;
+     unsigned long pingCount;
+};
+
+class SimIRBeacon
+{
+public:
+     // pin is the receiver output, which idles HIGH and goes LOW on carrier
+     explicit SimIRBeacon(uint8_t pin);
+
+     // Schedules one NEC frame per character starting at startUs, with
+     // gapUs of idle between frames. Returns when the last frame ends.
+     uint64_t send(uint64_t startUs, const char *text, uint32_t gapUs = 1000);
+     uint64_t send(uint64_t startUs, uint8_t value);
+
+private:
+     uint8_t receiverPin;
+};
+
+class SimKeypad
+{
+public:
+     SimKeypad(
+         const char *keys,
+         const uint8_t *rowPins,
+         const uint8_t *colPins,
+         uint8_t rows,
+         uint8_t cols);
+
+     // Closes the key's switch at atUs and opens it holdUs later
+     bool press(char key, uint64_t atUs, uint32_t holdUs = 50000);
+     // Presses each key in turn, spacing presses by intervalUs
+     uint64_t type(const char *keys, uint64_t startUs, uint32_t intervalUs = 100000);
+
+private:
+     const char *keymap;
+     const uint8_t *rowPins;
+     const uint8_t *colPins;
+     uint8_t numRows;
+     uint8_t numCols;
+};
+
+#endif // SimDevices_h
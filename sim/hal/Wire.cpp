@@ -0,0 +1,188 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  Wire.cpp - Simulated I2C master. A transaction of n data bytes costs
+  start + (address + n bytes) * 9 bits + stop at the configured bus clock.
+*/
+
+#include "Arduino.h"
+#include "ArduinoSim.h"
+#include "Wire.h"
+
+TwoWire::TwoWire()
+{
+     rxBufferIndex = 0;
+     rxBufferLength = 0;
+     txAddress = 0;
+     txBufferLength = 0;
+     transmitting = false;
+     txOverflow = false;
+}
+
+void TwoWire::begin()
+{
+     rxBufferIndex = 0;
+     rxBufferLength = 0;
+     txBufferLength = 0;
+}
+
+void TwoWire::begin(uint8_t)
+{
+     begin();
+}
+
+void TwoWire::begin(int address)
+{
+     begin((uint8_t)address);
+}
+
+void TwoWire::end()
+{
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+     if (clock > 0)
+          ArduinoSim::costs().i2cClockHz = clock;
+}
+
+void TwoWire::chargeBus(size_t bytes)
+{
+     // start + stop conditions are roughly one bit time each
+     uint64_t bits = (uint64_t)(bytes + 1) * 9 + 2;
+     uint64_t us = (bits * 1000000UL + ArduinoSim::costs().i2cClockHz - 1) /
+                   ArduinoSim::costs().i2cClockHz;
+     ArduinoSim::stats().i2cBusUs += us;
+     ArduinoSim::advance(us);
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+     transmitting = true;
+     txOverflow = false;
+     txAddress = address;
+     txBufferLength = 0;
+}
+
+void TwoWire::beginTransmission(int address)
+{
+     beginTransmission((uint8_t)address);
+}
+
+uint8_t TwoWire::endTransmission(uint8_t)
+{
+     SimI2CDevice *device = ArduinoSim::findI2C(txAddress);
+     SimStats &stats = ArduinoSim::stats();
+     transmitting = false;
+     stats.i2cWrites++;
+
+     if (device == nullptr)
+     {
+          // Address byte goes out and nobody acknowledges it
+          stats.i2cNacks++;
+          chargeBus(0);
+          txBufferLength = 0;
+          return 2;
+     }
+
+     stats.i2cBytes += txBufferLength;
+     chargeBus(txBufferLength);
+     device->receive(txBuffer, txBufferLength);
+     txBufferLength = 0;
+     return txOverflow ? 1 : 0;
+}
+
+uint8_t TwoWire::endTransmission(void)
+{
+     return endTransmission((uint8_t) true);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t)
+{
+     SimI2CDevice *device = ArduinoSim::findI2C(address);
+     SimStats &stats = ArduinoSim::stats();
+     stats.i2cReads++;
+     rxBufferIndex = 0;
+     rxBufferLength = 0;
+
+     if (quantity > BUFFER_LENGTH)
+          quantity = BUFFER_LENGTH;
+     if (device == nullptr)
+     {
+          stats.i2cNacks++;
+          chargeBus(0);
+          return 0;
+     }
+
+     size_t got = device->transmit(rxBuffer, quantity);
+     if (got > quantity)
+          got = quantity;
+     rxBufferLength = (uint8_t)got;
+     stats.i2cBytes += got;
+     chargeBus(got);
+     return rxBufferLength;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+     return requestFrom(address, quantity, (uint8_t) true);
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity)
+{
+     return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t) true);
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop)
+{
+     return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+     if (!transmitting)
+          return 0;
+     if (txBufferLength >= BUFFER_LENGTH)
+     {
+          txOverflow = true;
+          setWriteError();
+          return 0;
+     }
+     txBuffer[txBufferLength++] = data;
+     return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+     for (size_t i = 0; i < quantity; i++)
+     {
+          if (!write(data[i]))
+               return i;
+     }
+     return quantity;
+}
+
+int TwoWire::available(void)
+{
+     return rxBufferLength - rxBufferIndex;
+}
+
+int TwoWire::read(void)
+{
+     if (rxBufferIndex < rxBufferLength)
+          return rxBuffer[rxBufferIndex++];
+     return -1;
+}
+
+int TwoWire::peek(void)
+{
+     if (rxBufferIndex < rxBufferLength)
+          return rxBuffer[rxBufferIndex];
+     return -1;
+}
+
+void TwoWire::flush(void)
+{
+}
+
+TwoWire Wire;
@@ -0,0 +1,69 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  Wire.h - TwoWire on the simulated HAL. Transactions are delivered to the
+  SimI2CDevice registered at the target address (see ArduinoSim::attachI2C)
+  and charge the virtual clock for the bits they put on the bus. Buffer sizes
+  and return codes match the AVR Wire library.
+*/
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Print.h"
+
+#define BUFFER_LENGTH 32
+
+// WIRE_HAS_END means Wire has end()
+#define WIRE_HAS_END 1
+
+class TwoWire : public Print
+{
+public:
+     TwoWire();
+     void begin();
+     void begin(uint8_t address);
+     void begin(int address);
+     void end();
+     void setClock(uint32_t clock);
+     void beginTransmission(uint8_t address);
+     void beginTransmission(int address);
+     uint8_t endTransmission(void);
+     uint8_t endTransmission(uint8_t sendStop);
+     uint8_t requestFrom(uint8_t address, uint8_t quantity);
+     uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop);
+     uint8_t requestFrom(int address, int quantity);
+     uint8_t requestFrom(int address, int quantity, int sendStop);
+     virtual size_t write(uint8_t data);
+     virtual size_t write(const uint8_t *data, size_t quantity);
+     virtual int available(void);
+     virtual int read(void);
+     virtual int peek(void);
+     virtual void flush(void);
+
+     inline size_t write(unsigned long n) { return write((uint8_t)n); }
+     inline size_t write(long n) { return write((uint8_t)n); }
+     inline size_t write(unsigned int n) { return write((uint8_t)n); }
+     inline size_t write(int n) { return write((uint8_t)n); }
+     using Print::write;
+
+private:
+     uint8_t rxBuffer[BUFFER_LENGTH];
+     uint8_t rxBufferIndex;
+     uint8_t rxBufferLength;
+
+     uint8_t txAddress;
+     uint8_t txBuffer[BUFFER_LENGTH];
+     uint8_t txBufferLength;
+     bool transmitting;
+     bool txOverflow;
+
+     void chargeBus(size_t bytes);
+};
+
+extern TwoWire Wire;
+
+#endif // TwoWire_h
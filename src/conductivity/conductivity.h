@@ -24,6 +24,48 @@
  * function work, as well as Canvas for circuitry details.
  */
 
+#include <ConductivityProbe.h>
+
+// Drives the probe in the background for startConductivity()
+ConductivityProbe conductivityProbe;
+
+/**
+ * Starts a conductivity measurement in the background and returns right away.
+ * The probe is driven from conductivityReady() while your loop() keeps running,
+ * so call it at least every millisecond until it returns true (or add
+ * KNW_CONDUCTIVITY_TIMER; at the top of your sketch to drive the probe from a
+ * timer interrupt, see ConductivityProbe.h). Then get the reading from
+ * conductivityResult(). With the default arguments, the reading is the same as
+ * the one getConductivity() gives you.
+ *
+ * @param durationMs How long to let the probe settle, in milliseconds.
+ * @param frequency How many times per second the probe's polarity is flipped.
+ * @return true If the measurement was started, false otherwise.
+ */
+bool startConductivity(unsigned long durationMs = CONDUCTIVITY_DURATION_MS,
+                       int frequency = CONDUCTIVITY_FREQUENCY) {
+    return conductivityProbe.start(durationMs, frequency);
+}
+
+/**
+ * Tells you whether the measurement started by startConductivity() has finished.
+ * Call this often; it returns immediately.
+ *
+ * @return true If conductivityResult() has a fresh reading.
+ */
+bool conductivityReady() {
+    return conductivityProbe.ready();
+}
+
+/**
+ * The reading from the most recently finished conductivity measurement.
+ *
+ * @return int A value between [0 - 1023], or -1 if no measurement has finished yet.
+ */
+int conductivityResult() {
+    return conductivityProbe.result();
+}
+
 /**
  * Provides a reading of the conductivity probe.
  *
@@ -48,45 +90,24 @@
  * changing the resistors or fixing a broken connection) will require you to
  * recalibrate.
  *
- * @return int A value between [0 - 1023] telling you the raw analog pin reading.
+ * This blocks, waiting 3 seconds for the probe to settle (half a second more at
+ * most before giving up). To keep your robot moving while it does, use
+ * startConductivity() instead.
+ *
+ * @return int A value between [0 - 1023] telling you the raw analog pin reading,
+ * or -1 if the measurement could not be started (another one is already running)
+ * or did not finish in time.
  */
 int getConductivity() {
-    const unsigned long seconds = 3;
-
-    const int conductivityDigitalPin1 = 12;
-    const int conductivityDigitalPin2 = 13;
-    const int conductivityAnalogPin1 = 2;
-    const int conductivityAnalogPin2 = 3;
-
-    int reading1, reading2, result;
-
-    // One period of the wave is 10ms. So we want to
-    // repeat it numMilliseconds/10ms times
-    unsigned long loopCount = (seconds)*100ul;
-
-    pinMode(conductivityDigitalPin1, OUTPUT);
-    pinMode(conductivityDigitalPin2, OUTPUT);
-    digitalWrite(conductivityDigitalPin1, HIGH);
-    digitalWrite(conductivityDigitalPin2, HIGH);
-
-    // We make an alternating-phase square wave out of digital pins 12/13
-    // For this to work, we needed simultaneous digital pin writes. Refer to
-    // http://www.arduino.cc/en/Reference/PortManipulation
-    for (unsigned long i = 0; i < loopCount; ++i)
-    {
-        // The AND turns off pin 13, OR turns on pin 12
-        PORTB = B01000000 | (PORTB & B01111111);
-        delay(5);
-
-        // AND turns off pin 12, OR turns on pin 13
-        PORTB = B10000000 | (PORTB & B10111111);
-        delay(5);
+    // Same 3 second, 100Hz measurement as always, waiting for it to finish
+    if (!startConductivity())
+        return -1;
+    unsigned long start = millis();
+    while (!conductivityReady()) {
+        if (millis() - start > CONDUCTIVITY_DURATION_MS + CONDUCTIVITY_WAIT_MARGIN_MS) {
+            conductivityProbe.stop();
+            return -1;
+        }
     }
-
-    reading1 = analogRead(conductivityAnalogPin1);
-    reading2 = analogRead(conductivityAnalogPin2);
-    digitalWrite(conductivityDigitalPin1, LOW);
-    digitalWrite(conductivityDigitalPin2, LOW);
-
-    return result = abs(reading1 - reading2);
+    return conductivityResult();
 }
\ No newline at end of file
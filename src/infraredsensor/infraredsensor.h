@@ -1,20 +1,29 @@
 
 #ifndef INFRARED_SENSOR_H
 #define INFRARED_SENSOR_H
-// IR DETAILS
-#define EVENT_RISING 1
-#define EVENT_FALLING 2
-#define EVENT_NONE 0
-#define IR_WAIT 100000
+#include <IRReceiver.h>
 
-// Instance variables used in conjunction with the IR sensor
-unsigned char necState;
+// scanIR() listens this long, about as long as the old 100000-pass polling loop
+#define IR_SCAN_US 400000UL
+
+// Decodes in the background; follows whichever pin scanIR() was last given
+IRReceiver irReceiver;
+
+// Characters collected by the most recent scanIR()
 int num_chars;
-unsigned long prev_time;
+unsigned char buffer[9]; // 8 characters plus a terminating NUL
 
-unsigned char IRChar, IRCharBitMask, buffer[8];
-bool receiverState = false;
-unsigned long cur_time, ticks;
+/**
+ * Starts (or keeps) the receiver listening on the given pin.
+ */
+bool listenIR(int pin)
+{
+    if (pin == -1)
+        return false;
+    if (irReceiver.pin() != pin)
+        return irReceiver.begin(pin);
+    return true;
+}
 
 /**
  * This uses the IR sensor at the given digital pin to scan for beacons that
@@ -24,6 +33,9 @@ unsigned long cur_time, ticks;
  * The values that it reads are stored in an internal character buffer, which you
  * can access using getIR() after running this function.
  *
+ * scanIR() waits for up to 0.4 seconds (or until 8 characters arrive). To keep
+ * your robot moving while you listen for a beacon, use availableIR() and readIR().
+ *
  * <b>Note</b>: the function will return -1 if the pin passed for scanIR() is invalid
  * 
  * <b>Note</b>: every time you want to get fresh values from getIR(), you have to
@@ -50,128 +62,27 @@ unsigned long cur_time, ticks;
  */
 int scanIR(int pin)
 {
-    if (pin != -1)
-    {
-        // takes 13 ms per char to broadcast from a beacon
-        char reading;
-        unsigned char event;
-        // reset the buffer
-        memset(buffer, 0, sizeof(buffer));
-        num_chars = 0;
+    if (!listenIR(pin))
+        return -1; // this is for incorrect ID
 
-        unsigned long IRCounter = 0;
+    // takes 13 ms per char to broadcast from a beacon
+    // reset the buffer
+    memset(buffer, 0, sizeof(buffer));
+    num_chars = 0;
+    irReceiver.clear();
 
-        // Cycle while we try to watch for a character.
-        while (IRCounter < IR_WAIT)
+    unsigned long start = micros();
+    while (micros() - start < IR_SCAN_US && num_chars < (int)sizeof(buffer) - 1)
+    {
+        if (!irReceiver.interruptDriven())
+            irReceiver.poll();
+        while (num_chars < (int)sizeof(buffer) - 1 && irReceiver.available())
         {
-            // Digital level from IR receiver will be inverted
-            if (digitalRead(pin))
-            {
-                if (receiverState)
-                    event = EVENT_FALLING;
-                else
-                    event = EVENT_NONE;
-                receiverState = false;
-            }
-            else
-            {
-                if (!receiverState)
-                    event = EVENT_RISING;
-                else
-                    event = EVENT_NONE;
-                receiverState = true;
-            }
-            if (event != EVENT_NONE)
-            {
-                cur_time = micros();
-                ticks = cur_time - prev_time;
-                if (necState == 0)
-                { // Expecting rising edge of leading pulse
-                    if (event == EVENT_RISING)
-                    {
-                        necState = 1;
-                        // digitalWrite(ledPin,HIGH);
-                    }
-                }
-                else if (necState == 1)
-                { // Expecting falling edge of leading pulse
-                    if (event == EVENT_FALLING)
-                    {
-                        if (ticks > 8900L)
-                        {
-                            necState = 2; // Check for leading pulse > 8.9msec
-                        }
-                        else
-                        { // Stray short pulse found, reset NEC state
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0;
-                        }
-                    }
-                }
-                else if (necState == 2)
-                { // Expecting rising edge of first pulse after leading pulse
-                    if (event == EVENT_RISING)
-                    {
-                        if (ticks > 3375L)
-                        { // Check for space after leading pulse > 3.375 msec
-                            IRCharBitMask = 0x80;
-                            IRChar = 0;
-                            necState = 3;
-                        }
-                        else
-                        { // Space too short, reset NEC state to wait for another leading pulse
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0;
-                        }
-                    }
-                }
-                else if (necState == 3)
-                { // Expecting falling edge of data pulse
-                    if (event == EVENT_FALLING)
-                    {
-                        if (ticks < 648)
-                        {
-                            necState = 4; // Check if data pulse width < 648 usec
-                        }
-                        else
-                        { // Width too short, reset NEC state to wait for another leading pulse
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0;
-                        }
-                    }
-                }
-                else if (necState == 4)
-                { // Expecting rising edge of pulse after data pulse
-                    if (event == EVENT_RISING)
-                    {
-                        if (ticks > 1120)
-                        { // Record a '1' bit for space > 1120 usec
-                            IRChar = IRChar | IRCharBitMask;
-                        }
-                        IRCharBitMask = IRCharBitMask >> 1;
-
-                        if (IRCharBitMask == 0)
-                        {                               // Check if eighth bit received and character complete (!!!!!)
-                            buffer[num_chars] = IRChar; // Record complete character received in circular output buffer
-                            num_chars++;
-                            // buffer_in = (buffer_in + 1) & 0x07;
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0; // Reset NEC state to wait for another leading pulse
-                        }
-                        else
-                        {
-                            necState = 3; // Wait for falling edge of data pulse
-                        }
-                    }
-                }
-                prev_time = cur_time;
-            }
-            IRCounter++;
+            buffer[num_chars] = irReceiver.read();
+            num_chars++;
         }
-        // Serial.println(output);
-        return num_chars;
     }
-    return -1; // this is for incorrect ID
+    return num_chars;
 }
 
 /**
@@ -206,4 +117,48 @@ unsigned char *getIR()
     return buffer;
 }
 
+/**
+ * Tells you how many beacon characters the IR sensor on the given pin has
+ * received that you have not read yet. Unlike scanIR(), this returns
+ * immediately: the sensor is listened to in the background, so you can call
+ * this from loop() while your robot keeps moving. Asking about a different
+ * pin switches the receiver to it.
+ *
+ * @param pin The digital pin number that the IR sensor is connected to.
+ * @return int The number of characters waiting to be read, or -1 if the pin is invalid.
+ *
+ * Example code:
+ *
+ * @code
+ * #include <infraredsensor.h>
+ *
+ * while (availableIR(IRSensorPin) > 0) {
+ *   char beacon = readIR(IRSensorPin);
+ *   myRobot->printLCD(beacon);
+ * }
+ * @endcode
+ */
+int availableIR(int pin)
+{
+    if (!listenIR(pin))
+        return -1;
+    if (!irReceiver.interruptDriven())
+        irReceiver.poll();
+    return irReceiver.available();
+}
+
+/**
+ * Gives you the next beacon character received by the IR sensor on the given
+ * pin, or -1 if there is none waiting. Returns immediately; see availableIR().
+ *
+ * @param pin The digital pin number that the IR sensor is connected to.
+ * @return int The character that was received, or -1.
+ */
+int readIR(int pin)
+{
+    if (!listenIR(pin))
+        return -1;
+    return irReceiver.read();
+}
+
 #endif // INFRARED_SENSOR_H
\ No newline at end of file
@@ -0,0 +1,239 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  AnalogSampler.cpp - Round-robin background reading of analog pins.
+
+  The interrupt always knows which channel the finished conversion was
+  for (current), adds it to that channel's sum, publishes the average once
+  enough readings are in, and starts converting the next channel. The
+  multiplexer is set before each conversion is started, the same way
+  analogRead() does it, so every reading is of the pin it is stored for.
+*/
+
+#include "AnalogSampler.h"
+
+#if defined(__AVR__) && defined(ADC_vect)
+#define ANALOG_HAS_INTERRUPT 1
+#endif
+
+// Only one sampler can own the ADC at a time
+static AnalogSampler *interruptSampler;
+
+// Set when the sketch defined the interrupt with KNW_ANALOG_INTERRUPT
+static bool interruptEnabled = false;
+
+bool AnalogSampler::enableInterrupt()
+{
+#ifdef ANALOG_HAS_INTERRUPT
+    interruptEnabled = true;
+#endif
+    return interruptEnabled;
+}
+
+void AnalogSampler::adcInterrupt()
+{
+#ifdef ANALOG_HAS_INTERRUPT
+    if (interruptSampler)
+        interruptSampler->complete(ADC);
+#endif
+}
+
+AnalogSampler::AnalogSampler()
+{
+    count = 0;
+    current = 0;
+    conversionCount = 0;
+    active = false;
+    for (uint8_t i = 0; i < ANALOG_PINS; i++)
+        slots[i] = -1;
+}
+
+AnalogSampler::~AnalogSampler()
+{
+    stop();
+}
+
+bool AnalogSampler::add(uint8_t pin, uint8_t oversample)
+{
+    if (pin >= ANALOG_PINS || oversample == 0 || oversample > ANALOG_MAX_OVERSAMPLE)
+        return false;
+    uint8_t shift = 0;
+    while ((1 << shift) < oversample)
+        shift++;
+    if ((1 << shift) != oversample)
+        return false; // Not a power of 2
+
+    if (slots[pin] != -1)
+    {
+        Channel &channel = channels[slots[pin]];
+        noInterrupts();
+        channel.shift = shift;
+        channel.count = 0;
+        channel.sum = 0;
+        interrupts();
+        return true;
+    }
+    if (count == ANALOG_MAX_CHANNELS)
+        return false;
+
+    // Fill the channel in before the interrupt can see it
+    Channel &channel = channels[count];
+    channel.pin = pin;
+    channel.shift = shift;
+    channel.count = 0;
+    channel.sum = 0;
+    channel.values[0] = -1;
+    channel.values[1] = -1;
+    channel.front = 0;
+    channel.time = 0;
+    slots[pin] = count;
+    count = count + 1;
+    return true;
+}
+
+bool AnalogSampler::start()
+{
+    if (active)
+        return true;
+    if (count == 0 || interruptSampler != nullptr)
+        return false;
+
+    interruptSampler = this;
+    current = 0;
+    conversionCount = 0;
+    active = true;
+#ifdef ANALOG_HAS_INTERRUPT
+    if (interruptEnabled)
+    {
+        // Same /128 prescaler the Arduino core uses, plus the interrupt
+        ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+        convert(current);
+    }
+#endif
+    return true;
+}
+
+void AnalogSampler::stop()
+{
+    if (!active)
+        return;
+#ifdef ANALOG_HAS_INTERRUPT
+    if (interruptEnabled)
+    {
+        ADCSRA &= ~_BV(ADIE);
+        while (ADCSRA & _BV(ADSC))
+            ;
+        ADCSRA |= _BV(ADIF); // Writing 1 clears the flag of the last conversion
+    }
+#endif
+    active = false;
+    interruptSampler = nullptr;
+}
+
+bool AnalogSampler::running() const
+{
+    return active;
+}
+
+int AnalogSampler::sample(uint8_t pin)
+{
+    if (pin >= ANALOG_PINS)
+        return -1;
+    if (!active)
+        return analogRead(pin);
+    if (slots[pin] == -1)
+        return pausedRead(pin);
+
+    Channel &channel = channels[slots[pin]];
+    int value = channel.values[channel.front];
+    if (interruptEnabled)
+    {
+        if (value == -1)
+            return pausedRead(pin); // Just added, nothing converted yet
+        return value;
+    }
+
+    unsigned long now = micros();
+    if (value == -1 || now - channel.time > ANALOG_MAX_AGE_US)
+    {
+        value = analogRead(pin);
+        uint8_t back = channel.front ^ 1;
+        channel.values[back] = value;
+        channel.front = back;
+        channel.time = now;
+    }
+    return value;
+}
+
+bool AnalogSampler::sampling(uint8_t pin) const
+{
+    return pin < ANALOG_PINS && slots[pin] != -1;
+}
+
+unsigned long AnalogSampler::conversions() const
+{
+    noInterrupts();
+    unsigned long n = conversionCount;
+    interrupts();
+    return n;
+}
+
+void AnalogSampler::poll()
+{
+    if (active && !interruptEnabled)
+        complete(analogRead(channels[current].pin));
+}
+
+void AnalogSampler::complete(int value)
+{
+    Channel &channel = channels[current];
+    channel.sum += value;
+    channel.count++;
+    if (channel.count == (1 << channel.shift))
+    {
+        // Publish into the half sample() isn't reading, then flip
+        uint8_t back = channel.front ^ 1;
+        channel.values[back] = (channel.sum + ((1 << channel.shift) >> 1)) >> channel.shift;
+        channel.front = back;
+        channel.sum = 0;
+        channel.count = 0;
+        if (!interruptEnabled)
+            channel.time = micros();
+    }
+    conversionCount++;
+
+    current = (current + 1) % count;
+#ifdef ANALOG_HAS_INTERRUPT
+    if (interruptEnabled)
+        convert(current);
+#endif
+}
+
+#ifdef ANALOG_HAS_INTERRUPT
+// Only the interrupt starts conversions itself
+void AnalogSampler::convert(uint8_t channel)
+{
+    uint8_t pin = channels[channel].pin;
+    ADCSRB = (ADCSRB & ~_BV(MUX5)) | (((pin >> 3) & 0x01) << MUX5);
+    ADMUX = _BV(REFS0) | (pin & 0x07); // AVcc reference, like analogReference(DEFAULT)
+    ADCSRA |= _BV(ADSC);
+}
+#endif
+
+int AnalogSampler::pausedRead(uint8_t pin)
+{
+#ifdef ANALOG_HAS_INTERRUPT
+    if (interruptEnabled)
+    {
+        // Let the conversion in progress finish unseen, read, then convert it again
+        ADCSRA &= ~_BV(ADIE);
+        while (ADCSRA & _BV(ADSC))
+            ;
+        int value = analogRead(pin);
+        ADCSRA |= _BV(ADIF) | _BV(ADIE);
+        convert(current);
+        return value;
+    }
+#endif
+    return analogRead(pin);
+}
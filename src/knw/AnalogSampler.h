@@ -0,0 +1,129 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_ANALOGSAMPLER_H_
+#define SRC_KNW_ANALOGSAMPLER_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// Most analog pins the sampler can cycle through, and the analog pins there are
+#define ANALOG_MAX_CHANNELS 8
+#define ANALOG_PINS 16
+
+// Most readings averaged into one value (64 * 1023 still fits in 16 bits)
+#define ANALOG_MAX_OVERSAMPLE 64
+
+// Without the ADC interrupt, a value older than this is read again
+#define ANALOG_MAX_AGE_US 400
+
+/**
+ * Reads a set of analog pins over and over in the background, so reading
+ * one of them doesn't wait for the ADC.
+ *
+ * By default poll() (called from update()) reads the next of the pins that
+ * were add()ed, going round them, and sample() reads a pin itself when its
+ * value is older than ANALOG_MAX_AGE_US. Each pin can average several
+ * readings into one value.
+ *
+ * With KNW_ANALOG_INTERRUPT; in the sketch (outside any function), the ADC
+ * interrupt does the work instead: when a conversion finishes it stores the
+ * result and starts the next pin's, so the ADC never sits idle (about 9600
+ * readings a second, shared between the pins). Finished values are written
+ * to the half of a per-pin double buffer that isn't being read, and
+ * sample() just loads the other half. The macro defines ADC_vect, so it
+ * can't be used when the sketch or another library defines that vector;
+ * that is why it is opt-in.
+ *
+ * While the sampler is running it owns the ADC: read pins through sample()
+ * rather than analogRead(). With the interrupt, sample() of a pin that isn't
+ * being cycled through pauses the sampler for one plain analogRead().
+ *
+ * Example usage:
+ *
+ * @code
+ * AnalogSampler sampler;
+ * sampler.add(0, 4);
+ * sampler.start();
+ *
+ * void loop() {
+ *   int incline = sampler.sample(0);
+ * }
+ * @endcode
+ */
+class AnalogSampler
+{
+public:
+     AnalogSampler();
+     ~AnalogSampler();
+
+     /**
+      * Adds an analog pin [0 - 15] to the pins read in the background, each
+      * value being the average of oversample readings (1, 2, 4 ... 64). Adding
+      * a pin again changes its oversampling. Returns false if the pin or
+      * oversampling is invalid, or ANALOG_MAX_CHANNELS pins are already added.
+      */
+     bool add(uint8_t pin, uint8_t oversample = 1);
+
+     // Starts reading in the background. Returns false if no pin has been added.
+     bool start();
+
+     // Stops reading and gives the ADC back to analogRead()
+     void stop();
+
+     bool running() const;
+
+     // Latest value of an analog pin [0 - 1023]
+     int sample(uint8_t pin);
+
+     // true if the pin is read in the background
+     bool sampling(uint8_t pin) const;
+
+     // Conversions done since start()
+     unsigned long conversions() const;
+
+     // Reads the next pin when the ADC interrupt isn't available
+     void poll();
+
+     // Called with a finished conversion, from poll() or the ADC interrupt
+     void complete(int value);
+
+     // Lets samplers run from the ADC interrupt; see KNW_ANALOG_INTERRUPT
+     static bool enableInterrupt();
+
+     // Called from that interrupt
+     static void adcInterrupt();
+
+private:
+     struct Channel
+     {
+          uint8_t pin;
+          uint8_t shift; // log2 of the oversampling
+          uint8_t count; // readings in sum
+          unsigned int sum;
+          volatile int values[2];
+          volatile uint8_t front; // half of values sample() reads
+          unsigned long time; // micros() of the latest value, without the interrupt
+     };
+
+     Channel channels[ANALOG_MAX_CHANNELS];
+     volatile uint8_t count;
+     int8_t slots[ANALOG_PINS]; // channel of each analog pin, or -1
+     volatile uint8_t current; // channel being converted
+     volatile unsigned long conversionCount;
+     bool active;
+
+     void convert(uint8_t channel);
+     int pausedRead(uint8_t pin);
+};
+
+#if defined(__AVR__) && defined(ADC_vect)
+// Defines the ADC interrupt the sampler can run from (see AnalogSampler)
+#define KNW_ANALOG_INTERRUPT                                                 \
+     ISR(ADC_vect) { AnalogSampler::adcInterrupt(); }                        \
+     static const bool knwAnalogInterrupt = AnalogSampler::enableInterrupt()
+#endif
+
+#endif // SRC_KNW_ANALOGSAMPLER_H_
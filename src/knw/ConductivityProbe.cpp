@@ -0,0 +1,240 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  ConductivityProbe.cpp - Background excitation and sampling for the
+  conductivity probe.
+
+  The wave is the one getConductivity() has always produced: pin 12 high and
+  pin 13 low, then the other way around, switched together through PORTB.
+  A measurement is a count of half periods. tick() ends one half period:
+  it either flips the phase or, on the last one, finishes, and marks a
+  reading as due when it starts a pin-13 half inside the sampling window.
+  sample() takes that reading from the main loop, so the interrupt never
+  waits on the ADC; a reading the loop doesn't get to before the half
+  ends is dropped.
+*/
+
+#include "ConductivityProbe.h"
+
+#if defined(__AVR__) && defined(TIMER0_COMPB_vect)
+#define CONDUCTIVITY_HAS_TIMER 1
+#endif
+
+// Probe wiring
+#define CONDUCTIVITY_DIGITAL_PIN1 12 // PORTB bit 6
+#define CONDUCTIVITY_DIGITAL_PIN2 13 // PORTB bit 7
+#define CONDUCTIVITY_ANALOG_PIN1 2
+#define CONDUCTIVITY_ANALOG_PIN2 3
+
+// Only one probe can own the timer at a time
+static ConductivityProbe *timerProbe;
+
+// Set when the sketch defined the interrupt with KNW_CONDUCTIVITY_TIMER
+static bool timerEnabled = false;
+
+bool ConductivityProbe::enableTimer()
+{
+#ifdef CONDUCTIVITY_HAS_TIMER
+    timerEnabled = true;
+#endif
+    return timerEnabled;
+}
+
+void ConductivityProbe::timerInterrupt()
+{
+    if (timerProbe)
+        timerProbe->catchUp();
+}
+
+ConductivityProbe::ConductivityProbe()
+{
+    active = false;
+    finished = false;
+    halfPeriods = 0;
+    sampleWindow = 0;
+    sampleSum = 0;
+    sampleCount = 0;
+    sampleDue = false;
+    lastResult = -1;
+    sampler = nullptr;
+    halfPeriodUs = 0;
+    nextTick = 0;
+}
+
+ConductivityProbe::~ConductivityProbe()
+{
+    stop();
+}
+
+bool ConductivityProbe::start(unsigned long durationMs, int frequency)
+{
+    stop();
+    if (timerProbe != nullptr)
+        return false;
+
+    frequency = constrain(frequency, CONDUCTIVITY_MIN_FREQUENCY, CONDUCTIVITY_MAX_FREQUENCY);
+
+    // Single readings: averaging would mix in the other phase
+    if (sampler != nullptr)
+    {
+        sampler->add(CONDUCTIVITY_ANALOG_PIN1);
+        sampler->add(CONDUCTIVITY_ANALOG_PIN2);
+    }
+
+    // Whole periods only, and at least one
+    unsigned long periods = durationMs * frequency / 1000UL;
+    if (periods == 0)
+        periods = 1;
+    unsigned long samples = min(periods, (unsigned long)CONDUCTIVITY_SAMPLES);
+
+    finished = false;
+    sampleSum = 0;
+    sampleCount = 0;
+    sampleDue = false;
+    halfPeriods = periods * 2;
+    sampleWindow = samples * 2;
+    halfPeriodUs = 500000UL / frequency;
+
+    pinMode(CONDUCTIVITY_DIGITAL_PIN1, OUTPUT);
+    pinMode(CONDUCTIVITY_DIGITAL_PIN2, OUTPUT);
+
+    // The AND turns off pin 13, OR turns on pin 12
+    PORTB = B01000000 | (PORTB & B01111111);
+    nextTick = micros() + halfPeriodUs;
+    active = true;
+    timerProbe = this;
+
+#ifdef CONDUCTIVITY_HAS_TIMER
+    // Timer 0 is left as the core set it up; only its compare B interrupt is used
+    if (timerEnabled)
+    {
+        noInterrupts();
+        TIFR0 = _BV(OCF0B);
+        TIMSK0 |= _BV(OCIE0B);
+        interrupts();
+    }
+#endif
+    return true;
+}
+
+void ConductivityProbe::stop()
+{
+    if (timerProbe != this)
+        return;
+
+#ifdef CONDUCTIVITY_HAS_TIMER
+    if (timerEnabled)
+    {
+        // Also called from the interrupt by finish(), so don't turn interrupts back on there
+        uint8_t oldSREG = SREG;
+        cli();
+        TIMSK0 &= ~_BV(OCIE0B);
+        SREG = oldSREG;
+    }
+#endif
+
+    active = false;
+    timerProbe = nullptr;
+    digitalWrite(CONDUCTIVITY_DIGITAL_PIN1, LOW);
+    digitalWrite(CONDUCTIVITY_DIGITAL_PIN2, LOW);
+}
+
+bool ConductivityProbe::running()
+{
+    // Before catching up, so a late loop still reads the half that is ending
+    sample();
+    // No timer: run the wave from here
+    if (!timerEnabled)
+        catchUp();
+    return active;
+}
+
+bool ConductivityProbe::ready()
+{
+    running();
+    return finished;
+}
+
+int ConductivityProbe::result() const
+{
+    return lastResult;
+}
+
+void ConductivityProbe::setSampler(AnalogSampler *sampler)
+{
+    this->sampler = sampler;
+}
+
+void ConductivityProbe::catchUp()
+{
+    while (active && (long)(micros() - nextTick) >= 0)
+    {
+        tick();
+        nextTick += halfPeriodUs;
+    }
+}
+
+void ConductivityProbe::tick()
+{
+    if (!active)
+        return;
+
+    unsigned long left = halfPeriods - 1;
+    halfPeriods = left;
+    sampleDue = false;
+
+    if (left == 0)
+    {
+        finish();
+    }
+    else if (left % 2 == 0)
+    {
+        // The AND turns off pin 13, OR turns on pin 12
+        PORTB = B01000000 | (PORTB & B01111111);
+    }
+    else
+    {
+        // AND turns off pin 12, OR turns on pin 13
+        PORTB = B10000000 | (PORTB & B10111111);
+        sampleDue = left < sampleWindow;
+    }
+}
+
+void ConductivityProbe::sample()
+{
+    // Late in the half, like the reading the blocking loop took at its end
+    noInterrupts();
+    bool due = sampleDue && (long)(nextTick - micros()) <= (long)(halfPeriodUs / 2);
+    interrupts();
+    if (!due)
+        return;
+
+    int reading1, reading2;
+    if (sampler != nullptr)
+    {
+        reading1 = sampler->sample(CONDUCTIVITY_ANALOG_PIN1);
+        reading2 = sampler->sample(CONDUCTIVITY_ANALOG_PIN2);
+    }
+    else
+    {
+        reading1 = analogRead(CONDUCTIVITY_ANALOG_PIN1);
+        reading2 = analogRead(CONDUCTIVITY_ANALOG_PIN2);
+    }
+
+    // Only counts if the half didn't end while the pins were being read
+    noInterrupts();
+    if (sampleDue)
+    {
+        sampleSum += abs(reading1 - reading2);
+        sampleCount++;
+        sampleDue = false;
+    }
+    interrupts();
+}
+
+void ConductivityProbe::finish()
+{
+    lastResult = sampleCount > 0 ? (int)((sampleSum + sampleCount / 2) / sampleCount) : -1;
+    finished = true;
+    stop();
+}
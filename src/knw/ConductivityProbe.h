@@ -0,0 +1,144 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_CONDUCTIVITYPROBE_H_
+#define SRC_KNW_CONDUCTIVITYPROBE_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "AnalogSampler.h"
+
+// Defaults match the original blocking measurement: a 100Hz square wave for 3 seconds
+#define CONDUCTIVITY_DURATION_MS 3000
+#define CONDUCTIVITY_FREQUENCY 100
+
+// A blocking wait gives up this long after the measurement should have ended
+#define CONDUCTIVITY_WAIT_MARGIN_MS 500UL
+
+// Readings averaged at the end of a measurement, one per period
+#define CONDUCTIVITY_SAMPLES 10
+
+// The phase is flipped from a tick about every millisecond, so half a period
+// has to be at least 2 ticks long
+#define CONDUCTIVITY_MIN_FREQUENCY 4
+#define CONDUCTIVITY_MAX_FREQUENCY 250
+
+/**
+ * Drives the conductivity probe in the background.
+ *
+ * The probe is excited with an alternating-phase square wave on digital pins
+ * 12 and 13 (both on PORTB, so they switch at the same instant). The phase
+ * is flipped in the background, so loop() keeps running while the probe
+ * settles. Late in each pin-13 half of the last CONDUCTIVITY_SAMPLES
+ * periods, the difference between analog pins 2 and 3 is read, and those
+ * readings are averaged into result().
+ *
+ * By default ready() runs the wave itself, so call it often (at least every
+ * millisecond) while a measurement is running; update() does.
+ *
+ * To flip the phase from an interrupt instead, put KNW_CONDUCTIVITY_TIMER;
+ * in the sketch (outside any function). Every other timer on the MEGA
+ * belongs to the Servo library, NewPing or analogWrite(), so the wave rides
+ * on the millis() timer (timer 0): its compare B interrupt fires once per
+ * millis() tick (1.024ms) without the timer being changed, and flips the
+ * phase whenever a half period has come due on micros(). The wave's average
+ * frequency is exact, but each flip can come up to one tick late. The macro
+ * defines TIMER0_COMPB_vect, so it can't be used when the sketch or another
+ * library defines that vector; that is why it is opt-in.
+ *
+ * The interrupt never waits for the ADC, so other interrupts (the IR
+ * decoders, Serial) aren't held up by it. It only marks a reading as due
+ * when a sampled pin-13 half starts; ready() takes the reading once that
+ * half is more than halfway through. Call ready() at least every half
+ * period (5ms at 100Hz) during the last CONDUCTIVITY_SAMPLES periods, or
+ * the readings it misses are left out of the average.
+ *
+ * Given an AnalogSampler with setSampler(), the probe is read through it
+ * instead: start() adds both analog pins to it, and ready() only loads
+ * their latest values.
+ *
+ * Example usage:
+ *
+ * @code
+ * ConductivityProbe probe;
+ * probe.start();
+ *
+ * void loop() {
+ *   if (probe.ready()) {
+ *     int reading = probe.result();
+ *     probe.start();
+ *   }
+ *   // Keep driving
+ * }
+ * @endcode
+ */
+class ConductivityProbe
+{
+public:
+     ConductivityProbe();
+     ~ConductivityProbe();
+
+     /**
+      * Starts a measurement, stopping any that is already running. Returns
+      * false if another probe is measuring.
+      */
+     bool start(unsigned long durationMs = CONDUCTIVITY_DURATION_MS,
+                int frequency = CONDUCTIVITY_FREQUENCY);
+
+     // Stops the measurement and turns the excitation off
+     void stop();
+
+     // true while the square wave is running; also takes a reading that is due
+     bool running();
+
+     // true once a measurement has finished and result() is fresh
+     bool ready();
+
+     // Averaged reading of the last finished measurement [0 - 1023], or -1 if
+     // none has finished, or ready() wasn't called in time to take any reading
+     int result() const;
+
+     // Reads the probe through sampler (nullptr for analogRead())
+     void setSampler(AnalogSampler *sampler);
+
+     // Ends the current half period; called by catchUp() when one is due
+     void tick();
+
+     // Runs every half period that has come due
+     void catchUp();
+
+     // Lets the probe run from timer 0's compare B interrupt; see KNW_CONDUCTIVITY_TIMER
+     static bool enableTimer();
+
+     // Called from that interrupt
+     static void timerInterrupt();
+
+private:
+     volatile bool active;
+     volatile bool finished;
+     volatile unsigned long halfPeriods; // Half periods left in the measurement
+     volatile unsigned long sampleWindow; // Sample once fewer than this are left
+     volatile unsigned long sampleSum;
+     volatile unsigned int sampleCount;
+     volatile bool sampleDue; // A sampled pin-13 half is running and not read yet
+     volatile int lastResult;
+     AnalogSampler *sampler;
+
+     unsigned long halfPeriodUs;
+     volatile unsigned long nextTick; // micros() when the current half period ends
+
+     void sample();
+     void finish();
+};
+
+#if defined(__AVR__) && defined(TIMER0_COMPB_vect)
+// Defines the timer interrupt the probe can run from (see ConductivityProbe)
+#define KNW_CONDUCTIVITY_TIMER                                               \
+     ISR(TIMER0_COMPB_vect) { ConductivityProbe::timerInterrupt(); }          \
+     static const bool knwConductivityTimer = ConductivityProbe::enableTimer()
+#endif
+
+#endif // SRC_KNW_CONDUCTIVITYPROBE_H_
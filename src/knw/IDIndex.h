@@ -0,0 +1,77 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_IDINDEX_H_
+#define SRC_KNW_IDINDEX_H_
+
+#include <stdint.h>
+
+/**
+ * Finds which slot of a component array holds a user-chosen ID without
+ * scanning the array.
+ *
+ * A small open-addressed hash table: an ID goes in the bucket given by its
+ * low bits, or the next free one after it. IDs are never removed, and
+ * CAPACITY (a power of 2 no larger than 128) should be at least twice the
+ * number of components so chains stay short; IDs numbered 0, 1, 2 ... never
+ * share a bucket at all. Adding an ID that is already there keeps the first
+ * slot, the same one a scan from the front of the array would find.
+ */
+template <uint8_t CAPACITY>
+class IDIndex
+{
+     static_assert(CAPACITY >= 2 && CAPACITY <= 128 && (CAPACITY & (CAPACITY - 1)) == 0,
+                   "IDIndex capacity must be a power of 2 between 2 and 128");
+
+public:
+     IDIndex()
+     {
+          clear();
+     }
+
+     // Records that id lives in slot. Returns false if the table is full.
+     bool add(int id, uint8_t slot)
+     {
+          for (uint8_t i = 0, bucket = hash(id); i < CAPACITY; i++, bucket = (bucket + 1) & (CAPACITY - 1))
+          {
+               if (slots[bucket] == -1)
+               {
+                    ids[bucket] = id;
+                    slots[bucket] = slot;
+                    return true;
+               }
+               if (ids[bucket] == id)
+                    return true;
+          }
+          return false;
+     }
+
+     // Slot of id, or -1 if it was never added
+     int find(int id) const
+     {
+          for (uint8_t i = 0, bucket = hash(id); i < CAPACITY; i++, bucket = (bucket + 1) & (CAPACITY - 1))
+          {
+               if (slots[bucket] == -1)
+                    return -1;
+               if (ids[bucket] == id)
+                    return slots[bucket];
+          }
+          return -1;
+     }
+
+     void clear()
+     {
+          for (uint8_t i = 0; i < CAPACITY; i++)
+               slots[i] = -1;
+     }
+
+private:
+     int ids[CAPACITY];
+     int8_t slots[CAPACITY]; // -1 for an empty bucket
+
+     static uint8_t hash(int id)
+     {
+          return (uint8_t)id & (CAPACITY - 1);
+     }
+};
+
+#endif // SRC_KNW_IDINDEX_H_
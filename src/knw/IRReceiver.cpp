@@ -0,0 +1,399 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  IRReceiver.cpp - Interrupt-driven NEC decoder for the beacon receivers.
+
+  The interrupt only timestamps edges. Each queued edge is 16 bits: bit 15 is
+  the level the pin changed to and bits 0-14 are how long (in us, saturating
+  at 32767) the pin held its previous level. The state machine in decode()
+  is the one scanIR() has always used, fed from the queue instead of a
+  polling loop.
+
+  Decoded characters go into an IRRing for read(), and through frameChar()
+  which groups them into messages and folds repeats of the same beacon
+  string together.
+*/
+
+#include "IRReceiver.h"
+
+#if defined(__AVR__) && defined(PCICR)
+#define IR_USE_PCINT 1
+#endif
+
+// Queued edge layout. The receiver output is inverted: LOW means carrier.
+#define IR_EDGE_LEVEL 0x8000
+#define IR_EDGE_TICKS 0x7FFF
+
+static IRReceiver *receivers[IR_MAX_RECEIVERS];
+static bool pinChangeReceiver[IR_MAX_RECEIVERS];
+
+// Pin-change ports whose vector the sketch defined with KNW_IR_PIN_CHANGE
+static uint8_t pinChangePorts = 0;
+
+// attachInterrupt() takes a plain function, so each slot gets its own
+static void irEdge0() { receivers[0]->handleEdge(); }
+static void irEdge1() { receivers[1]->handleEdge(); }
+static void irEdge2() { receivers[2]->handleEdge(); }
+static void irEdge3() { receivers[3]->handleEdge(); }
+static void (*const irEdgeHandlers[IR_MAX_RECEIVERS])(void) = {
+    irEdge0, irEdge1, irEdge2, irEdge3};
+
+bool IRReceiver::enablePinChange(uint8_t port)
+{
+    if (port < 8)
+        pinChangePorts |= 1 << port;
+    return true;
+}
+
+// A pin-change vector covers a whole port, so ask every receiver using
+// pin-change interrupts; handleEdge() ignores pins that did not change.
+void IRReceiver::pinChange()
+{
+    for (uint8_t i = 0; i < IR_MAX_RECEIVERS; i++)
+    {
+        if (pinChangeReceiver[i])
+            receivers[i]->handleEdge();
+    }
+}
+
+IRReceiver::IRReceiver()
+{
+    receiverPin = -1;
+    slot = -1;
+    usingInterrupt = false;
+    edgeHead = 0;
+    edgeTail = 0;
+    lastLevel = HIGH;
+    lastEdgeTime = 0;
+    edgeOverruns = 0;
+    droppedFrames = 0;
+    clear();
+}
+
+IRReceiver::~IRReceiver()
+{
+    end();
+}
+
+bool IRReceiver::begin(int pin)
+{
+    end();
+    if (pin < 0 || pin >= NUM_DIGITAL_PINS)
+        return false;
+
+    for (uint8_t i = 0; i < IR_MAX_RECEIVERS; i++)
+    {
+        if (receivers[i] == nullptr)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == -1)
+        return false;
+
+    receiverPin = pin;
+    pinMode(receiverPin, INPUT);
+    clear();
+    edgeOverruns = 0;
+    lastLevel = digitalRead(receiverPin);
+    lastEdgeTime = micros();
+
+    noInterrupts();
+    receivers[slot] = this;
+    interrupts();
+
+    int irq = digitalPinToInterrupt(receiverPin);
+    if (irq != NOT_AN_INTERRUPT)
+    {
+        attachInterrupt(irq, irEdgeHandlers[slot], CHANGE);
+        usingInterrupt = true;
+    }
+#ifdef IR_USE_PCINT
+    else if (digitalPinToPCICR(receiverPin) != 0 &&
+             (pinChangePorts & _BV(digitalPinToPCICRbit(receiverPin))) != 0)
+    {
+        noInterrupts();
+        pinChangeReceiver[slot] = true;
+        *digitalPinToPCMSK(receiverPin) |= _BV(digitalPinToPCMSKbit(receiverPin));
+        *digitalPinToPCICR(receiverPin) |= _BV(digitalPinToPCICRbit(receiverPin));
+        interrupts();
+        usingInterrupt = true;
+    }
+#endif
+    return true;
+}
+
+void IRReceiver::end()
+{
+    if (slot == -1)
+        return;
+
+    int irq = digitalPinToInterrupt(receiverPin);
+    if (irq != NOT_AN_INTERRUPT)
+        detachInterrupt(irq);
+#ifdef IR_USE_PCINT
+    if (pinChangeReceiver[slot])
+    {
+        // Leave the port's PCIE bit alone; other receivers may share it
+        noInterrupts();
+        *digitalPinToPCMSK(receiverPin) &= ~_BV(digitalPinToPCMSKbit(receiverPin));
+        interrupts();
+    }
+#endif
+
+    noInterrupts();
+    pinChangeReceiver[slot] = false;
+    receivers[slot] = nullptr;
+    interrupts();
+
+    slot = -1;
+    receiverPin = -1;
+    usingInterrupt = false;
+}
+
+int IRReceiver::pin() const
+{
+    return receiverPin;
+}
+
+bool IRReceiver::interruptDriven() const
+{
+    return usingInterrupt;
+}
+
+void IRReceiver::poll()
+{
+    if (receiverPin != -1)
+        handleEdge();
+}
+
+void IRReceiver::handleEdge()
+{
+    uint8_t level = digitalRead(receiverPin);
+    if (level == lastLevel)
+        return;
+
+    unsigned long now = micros();
+    unsigned long ticks = now - lastEdgeTime;
+    lastEdgeTime = now;
+    lastLevel = level;
+
+    uint8_t next = (edgeHead + 1) & (IR_EDGE_BUFFER - 1);
+    if (next == edgeTail)
+    {
+        edgeOverruns++;
+        return;
+    }
+    if (ticks > IR_EDGE_TICKS)
+        ticks = IR_EDGE_TICKS;
+    edges[edgeHead] = (uint16_t)ticks | (level ? IR_EDGE_LEVEL : 0);
+    edgeHead = next;
+}
+
+void IRReceiver::processEdges()
+{
+    while (edgeTail != edgeHead)
+    {
+        uint16_t edge = edges[edgeTail];
+        edgeTail = (edgeTail + 1) & (IR_EDGE_BUFFER - 1);
+        decode(!(edge & IR_EDGE_LEVEL), edge & IR_EDGE_TICKS);
+    }
+}
+
+void IRReceiver::decode(bool carrier, unsigned int ticks)
+{
+    if (necState == 0)
+    { // Expecting rising edge of leading pulse
+        if (carrier)
+        {
+            gapBefore = ticks; // How long the beacon was quiet before this character
+            necState = 1;
+        }
+    }
+    else if (necState == 1)
+    { // Expecting falling edge of leading pulse
+        if (!carrier)
+        {
+            if (ticks > 8900)
+                necState = 2; // Check for leading pulse > 8.9msec
+            else
+                necState = 0; // Stray short pulse found, reset NEC state
+        }
+    }
+    else if (necState == 2)
+    { // Expecting rising edge of first pulse after leading pulse
+        if (carrier)
+        {
+            if (ticks > 3375)
+            { // Check for space after leading pulse > 3.375 msec
+                IRCharBitMask = 0x80;
+                IRChar = 0;
+                necState = 3;
+            }
+            else
+            { // Space too short, reset NEC state to wait for another leading pulse
+                necState = 0;
+            }
+        }
+    }
+    else if (necState == 3)
+    { // Expecting falling edge of data pulse
+        if (!carrier)
+        {
+            if (ticks < 648)
+                necState = 4; // Check if data pulse width < 648 usec
+            else
+                necState = 0; // Width too long, wait for another leading pulse
+        }
+    }
+    else if (necState == 4)
+    { // Expecting rising edge of pulse after data pulse
+        if (carrier)
+        {
+            if (ticks > 1120)
+            { // Record a '1' bit for space > 1120 usec
+                IRChar = IRChar | IRCharBitMask;
+            }
+            IRCharBitMask = IRCharBitMask >> 1;
+
+            if (IRCharBitMask == 0)
+            { // Eighth bit received, character complete
+                if (!chars.push(IRChar))
+                    partialDropped = true;
+                frameChar(IRChar);
+                necState = 0; // Reset NEC state to wait for another leading pulse
+            }
+            else
+            {
+                necState = 3; // Wait for falling edge of data pulse
+            }
+        }
+    }
+}
+
+void IRReceiver::frameChar(unsigned char c)
+{
+    if (partialLength > 0 && gapBefore >= IR_FRAME_GAP_US)
+        endMessage();
+    partial[partialLength++] = c;
+    if (partialLength == IR_MESSAGE_MAX)
+        endMessage();
+}
+
+void IRReceiver::endMessage()
+{
+    uint8_t length = partialLength;
+    partialLength = 0;
+    if (partialDropped)
+    {
+        droppedFrames++;
+        partialDropped = false;
+    }
+    if (length == 0)
+        return;
+
+    // Shortest string that the message is a repeat of ("KNWKNWK" -> "KNW")
+    uint8_t period = 1;
+    for (; period < length; period++)
+    {
+        uint8_t i = period;
+        while (i < length && partial[i] == partial[i - period])
+            i++;
+        if (i == length)
+            break;
+    }
+    // A beacon sending without pauses can be picked up mid-string, so
+    // "NWK" counts as a repeat of "KNW"
+    if (period == lastLength)
+    {
+        for (uint8_t shift = 0; shift < period; shift++)
+        {
+            uint8_t i = 0;
+            while (i < period && partial[(i + shift) % period] == lastMessage[i])
+                i++;
+            if (i == period)
+            {
+                messageChars += length;
+                return;
+            }
+        }
+    }
+
+    memcpy(lastMessage, partial, period);
+    lastMessage[period] = '\0';
+    lastLength = period;
+    messageChars = length;
+    newMessage = true;
+}
+
+int IRReceiver::available()
+{
+    processEdges();
+    return chars.available();
+}
+
+int IRReceiver::read()
+{
+    processEdges();
+    return chars.pop();
+}
+
+bool IRReceiver::messageAvailable()
+{
+    processEdges();
+    if (partialLength > 0)
+    {
+        noInterrupts();
+        unsigned long quiet = micros() - lastEdgeTime;
+        interrupts();
+        if (quiet >= IR_FRAME_GAP_US)
+            endMessage();
+    }
+    return newMessage;
+}
+
+const char *IRReceiver::message()
+{
+    messageAvailable();
+    newMessage = false;
+    return lastMessage;
+}
+
+unsigned int IRReceiver::repeats() const
+{
+    // Characters that arrived without a pause may end partway through a
+    // repeat, so count whole repeats across every chunk received
+    return lastLength == 0 ? 0 : messageChars / lastLength;
+}
+
+void IRReceiver::clear()
+{
+    edgeTail = edgeHead;
+    necState = 0;
+    IRChar = 0;
+    IRCharBitMask = 0;
+    gapBefore = 0;
+    chars.clear();
+    partialLength = 0;
+    lastMessage[0] = '\0';
+    lastLength = 0;
+    messageChars = 0;
+    newMessage = false;
+    partialDropped = false;
+}
+
+unsigned int IRReceiver::overruns() const
+{
+    return edgeOverruns;
+}
+
+unsigned int IRReceiver::dropped() const
+{
+    return droppedFrames + (partialDropped ? 1 : 0);
+}
+
+void IRReceiver::setOverflow(IROverflow overflow)
+{
+    chars.setOverflow(overflow);
+}
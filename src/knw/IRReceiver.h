@@ -0,0 +1,183 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_IRRECEIVER_H_
+#define SRC_KNW_IRRECEIVER_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "IRRing.h"
+
+// How many receivers can be listening at the same time
+#define IR_MAX_RECEIVERS 4
+
+// Edges queued between the interrupt and the decoder. One beacon character
+// is 20 edges, so this holds about three characters. Must be a power of 2.
+#define IR_EDGE_BUFFER 64
+
+// Decoded characters waiting to be read. Must be a power of 2 up to 128.
+// It sets the size of every IRReceiver, so it is fixed here rather than
+// overridable from a sketch, which would disagree with the library about it.
+#define IR_CHAR_BUFFER 32
+
+// Silence (in us) that ends a beacon message. The edge timings saturate at
+// 32767us, so keep this below that.
+#define IR_FRAME_GAP_US 20000
+
+// Longest beacon message that message() can hold
+#define IR_MESSAGE_MAX 16
+
+/**
+ * Decodes the NEC-encoded characters sent by the course beacons.
+ *
+ * The receiver's output pin is watched with an interrupt: every time it
+ * changes, the interrupt records how long the pin held its previous level
+ * into a small queue and returns. The NEC state machine that turns those
+ * timings into characters runs later, from available() or read(), so the
+ * robot is free to do other work while a beacon is transmitting.
+ *
+ * Characters are also grouped into messages: a message ends when the beacon
+ * goes quiet for IR_FRAME_GAP_US, or when IR_MESSAGE_MAX characters arrive
+ * without a pause. Beacons repeat the same string over and over, so a
+ * message that only repeats a shorter string (or is the same as the previous
+ * message) is counted in repeats() instead of being reported again.
+ *
+ * Pins with an external interrupt (2, 3, 18, 19, 20, 21 on the MEGA) use
+ * attachInterrupt(). Any other pin falls back to polling: call poll() as
+ * often as possible (at least every 100us) while a beacon is transmitting.
+ *
+ * Pin-change interrupts are opt-in, because SoftwareSerial and other
+ * libraries define the same interrupt vectors and the sketch would no
+ * longer link. To use one, put KNW_IR_PIN_CHANGE(n) in the sketch (outside
+ * any function) for the port the receiver's pin is on, and only that
+ * port's vector is defined:
+ *
+ * - KNW_IR_PIN_CHANGE(0): pins 10-13 and 50-53
+ * - KNW_IR_PIN_CHANGE(2): pins A8-A15
+ *
+ * Pins on a port without it keep polling.
+ *
+ * Example usage:
+ *
+ * @code
+ * IRReceiver receiver;
+ * receiver.begin(10);
+ *
+ * void loop() {
+ *   while (receiver.available()) {
+ *     char c = receiver.read();
+ *     // Do something with c
+ *   }
+ *   // Keep driving
+ * }
+ * @endcode
+ */
+class IRReceiver
+{
+public:
+     IRReceiver();
+     ~IRReceiver();
+
+     /**
+      * Starts listening on the given digital pin. Returns false if the pin
+      * is invalid or IR_MAX_RECEIVERS receivers are already listening.
+      */
+     bool begin(int pin);
+
+     // Stops listening and releases the interrupt
+     void end();
+
+     // The pin this receiver is listening on, or -1
+     int pin() const;
+
+     // true if edges are captured by an interrupt, false if poll() is needed
+     bool interruptDriven() const;
+
+     // Samples the pin once; only needed when interruptDriven() is false
+     void poll();
+
+     // Number of decoded characters waiting to be read
+     int available();
+
+     // Next decoded character, or -1 if there is none
+     int read();
+
+     // Throws away queued edges, characters and messages and restarts the decoder
+     void clear();
+
+     // Edges lost because the decoder did not keep up with the interrupt
+     unsigned int overruns() const;
+
+     // Messages (frames) that lost characters because nobody read them
+     // before the buffer filled up; a message still arriving counts too
+     unsigned int dropped() const;
+
+     // What to lose when the character buffer is full (IR_DROP_NEWEST by default)
+     void setOverflow(IROverflow overflow);
+
+     // true when a message different from the previous one has arrived
+     bool messageAvailable();
+
+     // The most recent complete message (NUL-terminated, "" if none yet).
+     // Marks it as seen, so messageAvailable() returns false until the next one.
+     const char *message();
+
+     // How many times in a row message() has been received
+     unsigned int repeats() const;
+
+     // Called from the interrupt when the pin changes
+     void handleEdge();
+
+     // Lets receivers on pin-change port n use its interrupt; see KNW_IR_PIN_CHANGE
+     static bool enablePinChange(uint8_t port);
+
+     // Called from a pin-change interrupt; asks every receiver using one
+     static void pinChange();
+
+private:
+     int receiverPin;
+     int8_t slot;
+     bool usingInterrupt;
+
+     // Written by the interrupt, read by the decoder
+     volatile uint16_t edges[IR_EDGE_BUFFER];
+     volatile uint8_t edgeHead;
+     volatile uint8_t edgeTail;
+     volatile uint8_t lastLevel;
+     volatile unsigned long lastEdgeTime;
+     volatile unsigned int edgeOverruns;
+
+     // NEC decoder state
+     unsigned char necState;
+     unsigned char IRChar;
+     unsigned char IRCharBitMask;
+     unsigned int gapBefore;
+     IRRing<IR_CHAR_BUFFER> chars;
+
+     // Message framing
+     char partial[IR_MESSAGE_MAX];
+     uint8_t partialLength;
+     char lastMessage[IR_MESSAGE_MAX + 1];
+     uint8_t lastLength;
+     unsigned int messageChars; // Characters received for lastMessage, repeats included
+     bool newMessage;
+     bool partialDropped; // The message being received lost a character
+     unsigned int droppedFrames;
+
+     void processEdges();
+     void decode(bool carrier, unsigned int ticks);
+     void frameChar(unsigned char c);
+     void endMessage();
+};
+
+#if defined(__AVR__) && defined(PCICR)
+// Defines pin-change interrupt vector n for the IR receivers (see IRReceiver)
+#define KNW_IR_PIN_CHANGE(n)                                                 \
+     ISR(PCINT##n##_vect) { IRReceiver::pinChange(); }                       \
+     static const bool knwIRPinChange##n = IRReceiver::enablePinChange(n)
+#endif
+
+#endif // SRC_KNW_IRRECEIVER_H_
@@ -0,0 +1,108 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_IRRING_H_
+#define SRC_KNW_IRRING_H_
+
+#include <stdint.h>
+
+// What IRRing::push() does when the ring is full
+enum IROverflow
+{
+     IR_DROP_NEWEST,     // Keep what is queued and discard the new byte
+     IR_OVERWRITE_OLDEST // Discard the oldest queued byte to make room
+};
+
+/**
+ * Fixed-size queue of decoded beacon bytes.
+ *
+ * IRReceiver decodes from available() and read(), so push() and pop() both
+ * run in the main loop and the ring needs no locking. CAPACITY must be a
+ * power of 2 no larger than 128 so the 8-bit indexes can wrap freely.
+ */
+template <uint8_t CAPACITY>
+class IRRing
+{
+     static_assert(CAPACITY >= 2 && CAPACITY <= 128 && (CAPACITY & (CAPACITY - 1)) == 0,
+                   "IRRing capacity must be a power of 2 between 2 and 128");
+
+public:
+     IRRing()
+     {
+          policy = IR_DROP_NEWEST;
+          droppedBytes = 0;
+          head = 0;
+          tail = 0;
+     }
+
+     // Queues a byte. Returns false if a byte (new or old) had to be dropped
+     bool push(uint8_t value)
+     {
+          uint8_t h = head;
+          if ((uint8_t)(h - tail) == CAPACITY)
+          {
+               droppedBytes++;
+               if (policy == IR_DROP_NEWEST)
+                    return false;
+               tail = tail + 1;
+               data[h & (CAPACITY - 1)] = value;
+               head = h + 1;
+               return false;
+          }
+          data[h & (CAPACITY - 1)] = value;
+          head = h + 1;
+          return true;
+     }
+
+     // Oldest queued byte, or -1 if the ring is empty
+     int pop()
+     {
+          uint8_t t = tail;
+          if (t == head)
+               return -1;
+          uint8_t value = data[t & (CAPACITY - 1)];
+          tail = t + 1;
+          return value;
+     }
+
+     // Number of bytes waiting to be popped
+     uint8_t available() const
+     {
+          return (uint8_t)(head - tail);
+     }
+
+     // Empties the ring; the dropped counter is kept
+     void clear()
+     {
+          tail = head;
+     }
+
+     // Bytes lost to a full ring since the last resetDropped()
+     unsigned int dropped() const
+     {
+          return droppedBytes;
+     }
+
+     void resetDropped()
+     {
+          droppedBytes = 0;
+     }
+
+     void setOverflow(IROverflow overflow)
+     {
+          policy = overflow;
+     }
+
+     uint8_t capacity() const
+     {
+          return CAPACITY;
+     }
+
+private:
+     uint8_t data[CAPACITY];
+     uint8_t head;
+     uint8_t tail;
+     unsigned int droppedBytes;
+     IROverflow policy;
+};
+
+#endif // SRC_KNW_IRRING_H_
@@ -0,0 +1,296 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_KNWCONFIG_H_
+#define SRC_KNW_KNWCONFIG_H_
+
+#include "KNWRobot.h"
+
+/*
+  Robot configurations that are checked when the sketch compiles.
+
+  A KNWConfig lists every component of a robot as a template argument. The
+  compiler then checks the list the way the setup functions check each call
+  at runtime (the pin exists, nothing else is using it, there is room for
+  one more) and refuses to compile a robot that would fail, instead of
+  setupPing() or setupServo() quietly returning false on the robot.
+
+  The config also holds arrays for exactly the components it lists, which
+  the robot uses instead of allocating room for the most it supports; a
+  robot with 2 ping sensors and 2 servos doesn't carry 6 unused sensors,
+  4 unused IR decoders and 14 unused servos in its memory.
+
+  Example usage:
+
+  @code
+  KNWConfig<
+      KNWPing<1, 24, 25>,
+      KNWBump<2, 30>,
+      KNWServo<3, 0, 94, 'p'>,
+      KNWMotor<4, 6>,
+      KNWIncline<8>>
+      config;
+  KNWRobot *myRobot;
+
+  void setup() {
+    myRobot = new KNWRobot(config.storage());
+    config.setup(*myRobot);
+  }
+  @endcode
+*/
+
+// ******************************************* //
+// Components
+// ******************************************* //
+// Each component says what kind it is ('u' ping, 'b' bump, 'r' IR, 's' servo,
+// 'm' DC motor, 'i' incline, 't' temperature), the ID it gets (-1 for none),
+// which pins it takes ('d' digital, 'a' analog, 'p' PCA board; -1 for an
+// unused second pin) and how to set it up on a robot.
+
+template <int ID, int TRIGGER, int ECHO, int MAX_DISTANCE = 200>
+struct KNWPing
+{
+     static constexpr char kind = 'u';
+     static constexpr int id = ID;
+     static constexpr char space = 'd';
+     static constexpr int pin1 = TRIGGER;
+     static constexpr int pin2 = ECHO == TRIGGER ? -1 : ECHO; // sensors may share one pin
+     static_assert(MAX_DISTANCE > 0, "KNWPing needs a positive max distance");
+
+     static bool setup(KNWRobot &robot)
+     {
+          return robot.setupPing(ID, TRIGGER, ECHO, MAX_DISTANCE);
+     }
+};
+
+template <int ID, int PIN>
+struct KNWBump
+{
+     static constexpr char kind = 'b';
+     static constexpr int id = ID;
+     static constexpr char space = 'd';
+     static constexpr int pin1 = PIN;
+     static constexpr int pin2 = -1;
+
+     static bool setup(KNWRobot &robot)
+     {
+          return robot.setupBump(ID, PIN);
+     }
+};
+
+template <int ID, int PIN>
+struct KNWIR
+{
+     static constexpr char kind = 'r';
+     static constexpr int id = ID;
+     static constexpr char space = 'd';
+     static constexpr int pin1 = PIN;
+     static constexpr int pin2 = -1;
+
+     static bool setup(KNWRobot &robot)
+     {
+          return robot.setupIR(ID, PIN);
+     }
+};
+
+template <int ID, int PIN, int ZERO = 94, char TYPE = 'd'>
+struct KNWServo
+{
+     static constexpr char kind = 's';
+     static constexpr int id = ID;
+     static constexpr char space = TYPE;
+     static constexpr int pin1 = PIN;
+     static constexpr int pin2 = -1;
+     static_assert(TYPE == 'd' || TYPE == 'p', "KNWServo type must be 'd' or 'p'");
+
+     static bool setup(KNWRobot &robot)
+     {
+          return robot.setupServo(ID, PIN, ZERO, TYPE);
+     }
+};
+
+template <int ID, int PIN, int ZERO = 90, char TYPE = 'd'>
+struct KNWMotor
+{
+     static constexpr char kind = 'm';
+     static constexpr int id = ID;
+     static constexpr char space = TYPE;
+     static constexpr int pin1 = PIN;
+     static constexpr int pin2 = -1;
+     static_assert(TYPE == 'd' || TYPE == 'p', "KNWMotor type must be 'd' or 'p'");
+
+     static bool setup(KNWRobot &robot)
+     {
+          return robot.setupMotor(ID, PIN, ZERO, TYPE);
+     }
+};
+
+template <int PIN>
+struct KNWIncline
+{
+     static constexpr char kind = 'i';
+     static constexpr int id = -1;
+     static constexpr char space = 'a';
+     static constexpr int pin1 = PIN;
+     static constexpr int pin2 = -1;
+
+     static bool setup(KNWRobot &robot)
+     {
+          return robot.setupIncline(PIN);
+     }
+};
+
+template <int PIN>
+struct KNWTemp
+{
+     static constexpr char kind = 't';
+     static constexpr int id = -1;
+     static constexpr char space = 'a';
+     static constexpr int pin1 = PIN;
+     static constexpr int pin2 = -1;
+
+     static bool setup(KNWRobot &robot)
+     {
+          return robot.setupTemp(PIN);
+     }
+};
+
+// ******************************************* //
+// Checks
+// ******************************************* //
+// true if a pin exists and the robot doesn't keep it for itself: the serial
+// pins, the keypad (odd pins 39 - 53) and the conductivity probe (digital 12
+// and 13, analog 2 and 3), the same pins KNWRobot's constructor reserves
+constexpr bool knwPinFree(char space, int pin)
+{
+     return space == 'd'   ? pin >= 0 && pin < 54 && pin != 0 && pin != 1 && pin != 12 && pin != 13 &&
+                               !(pin >= 14 && pin <= 21) && !(pin >= 39 && pin % 2 == 1)
+            : space == 'a' ? pin >= 0 && pin < 16 && pin != 2 && pin != 3
+            : space == 'p' ? pin >= 0 && pin < 16
+                           : false;
+}
+
+// Checks a list of components, one at a time from the front
+template <typename... Parts>
+struct KNWParts;
+
+template <>
+struct KNWParts<>
+{
+     static constexpr int count(char) { return 0; }
+     static constexpr bool uses(char, int) { return false; }
+     static constexpr bool hasID(char, int) { return false; }
+     static constexpr bool pinsFree() { return true; }
+     static constexpr bool pinsUnique() { return true; }
+     static constexpr bool idsUnique() { return true; }
+     static bool setup(KNWRobot &) { return true; }
+};
+
+template <typename Part, typename... Rest>
+struct KNWParts<Part, Rest...>
+{
+     typedef KNWParts<Rest...> Next;
+
+     // How many components of a kind the list has
+     static constexpr int count(char kind)
+     {
+          return (Part::kind == kind ? 1 : 0) + Next::count(kind);
+     }
+
+     // true if a component in the list takes the pin
+     static constexpr bool uses(char space, int pin)
+     {
+          return (Part::space == space && (Part::pin1 == pin || Part::pin2 == pin)) || Next::uses(space, pin);
+     }
+
+     // true if a component of the kind in the list has the ID
+     static constexpr bool hasID(char kind, int id)
+     {
+          return (Part::kind == kind && Part::id == id) || Next::hasID(kind, id);
+     }
+
+     static constexpr bool pinsFree()
+     {
+          return knwPinFree(Part::space, Part::pin1) &&
+                 (Part::pin2 == -1 || knwPinFree(Part::space, Part::pin2)) && Next::pinsFree();
+     }
+
+     static constexpr bool pinsUnique()
+     {
+          return !Next::uses(Part::space, Part::pin1) &&
+                 (Part::pin2 == -1 || !Next::uses(Part::space, Part::pin2)) && Next::pinsUnique();
+     }
+
+     static constexpr bool idsUnique()
+     {
+          return (Part::id == -1 || !Next::hasID(Part::kind, Part::id)) && Next::idsUnique();
+     }
+
+     // Sets up every component, even after one fails; false if any did
+     static bool setup(KNWRobot &robot)
+     {
+          bool ok = Part::setup(robot);
+          return Next::setup(robot) && ok;
+     }
+};
+
+// An array of N components, or nothing at all when there are none
+template <typename T, int N>
+struct KNWSlots
+{
+     T items[N];
+     T *data() { return items; }
+};
+
+template <typename T>
+struct KNWSlots<T, 0>
+{
+     T *data() { return nullptr; }
+};
+
+// ******************************************* //
+// Configuration
+// ******************************************* //
+template <typename... Parts>
+class KNWConfig
+{
+     typedef KNWParts<Parts...> List;
+
+     static_assert(List::pinsFree(), "KNWConfig uses a pin that doesn't exist or that the robot keeps for itself");
+     static_assert(List::pinsUnique(), "KNWConfig uses the same pin for two components");
+     static_assert(List::idsUnique(), "KNWConfig gives two components of the same kind the same ID");
+     static_assert(List::count('u') <= KNW_MAX_PINGS, "KNWConfig has too many ping sensors");
+     static_assert(List::count('b') <= KNW_MAX_BUMPS, "KNWConfig has too many bump sensors");
+     static_assert(List::count('r') <= KNW_MAX_IR, "KNWConfig has too many IR sensors");
+     static_assert(List::count('s') <= KNW_MAX_SERVOS, "KNWConfig has too many servos");
+     static_assert(List::count('m') <= KNW_MAX_MOTORS, "KNWConfig has too many DC motors");
+     static_assert(List::count('i') <= 1, "KNWConfig has more than one incline sensor");
+     static_assert(List::count('t') <= 1, "KNWConfig has more than one temperature probe");
+
+public:
+     // Storage for KNWRobot's constructor; the config must outlive the robot
+     KNWStorage storage()
+     {
+          KNWStorage result = {
+              pings.data(), List::count('u'),
+              bumps.data(), List::count('b'),
+              irs.data(), List::count('r'),
+              motors.data(), List::count('m'),
+              servos.data(), List::count('s')};
+          return result;
+     }
+
+     // Sets every component up on the robot; false if any setup failed at runtime
+     bool setup(KNWRobot &robot)
+     {
+          return List::setup(robot);
+     }
+
+private:
+     KNWSlots<PingSensor, List::count('u')> pings;
+     KNWSlots<Component, List::count('b')> bumps;
+     KNWSlots<IRSensor, List::count('r')> irs;
+     KNWSlots<Motor, List::count('m')> motors;
+     KNWSlots<Motor, List::count('s')> servos;
+};
+
+#endif // SRC_KNW_KNWCONFIG_H_
@@ -0,0 +1,72 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  KNWFormat.cpp - Fixed point number formatting for the LCD.
+
+  The value is scaled by a power of ten from a table and rounded once into
+  an unsigned long, and the digits are then peeled off the end of that
+  integer, so there is no pow(), and no second round of floating point
+  error on the digits after the point.
+*/
+
+#include "KNWFormat.h"
+
+static const unsigned long POWERS_OF_TEN[FORMAT_MAX_DECIMALS + 1] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL};
+
+// Scaled values from here up don't fit an unsigned long (on the arduino,
+// where a double is a float, this rounds up to 2^32)
+#define FORMAT_MAX_SCALED 4294967295.0
+
+static int copyText(char *buffer, const char *text, int width)
+{
+    int length = strlen(text);
+    int pad = width > length ? width - length : 0;
+    memset(buffer, ' ', pad);
+    strcpy(buffer + pad, text);
+    return pad + length;
+}
+
+int formatDecimal(char *buffer, double value, int decimals, int width)
+{
+    decimals = constrain(decimals, 0, FORMAT_MAX_DECIMALS);
+    width = constrain(width, 0, FORMAT_MAX_WIDTH);
+
+    if (value != value)
+        return copyText(buffer, "nan", width);
+
+    bool negative = value < 0;
+    if (negative)
+        value = -value;
+
+    // Give up decimals before giving up on the number
+    while (decimals > 0 && value * POWERS_OF_TEN[decimals] + 0.5 >= FORMAT_MAX_SCALED)
+        decimals--;
+    double scaled = value * POWERS_OF_TEN[decimals] + 0.5;
+    if (scaled >= FORMAT_MAX_SCALED)
+        return copyText(buffer, negative ? "-ovf" : "ovf", width);
+    unsigned long digits = (unsigned long)scaled;
+    if (digits == 0)
+        negative = false;
+
+    // Digits go in from the right: the decimals, the point, then the whole part
+    char text[FORMAT_BUFFER];
+    char *start = text + sizeof(text) - 1;
+    *start = '\0';
+    for (int i = 0; i < decimals; i++)
+    {
+        *--start = '0' + digits % 10;
+        digits /= 10;
+    }
+    if (decimals > 0)
+        *--start = '.';
+    do
+    {
+        *--start = '0' + digits % 10;
+        digits /= 10;
+    } while (digits != 0);
+    if (negative)
+        *--start = '-';
+
+    return copyText(buffer, start, width);
+}
@@ -0,0 +1,50 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_KNWFORMAT_H_
+#define SRC_KNW_KNWFORMAT_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// Most digits after the decimal point; a double on the arduino only holds
+// about 7 significant digits anyway
+#define FORMAT_MAX_DECIMALS 6
+
+// Room formatDecimal() needs, including the terminating NUL, for any width
+// up to FORMAT_MAX_WIDTH
+#define FORMAT_MAX_WIDTH 16
+#define FORMAT_BUFFER 24
+
+/**
+ * Writes value with a fixed number of digits after the decimal point into
+ * buffer, rounded to the nearest last digit. The value is scaled and rounded
+ * to an integer once, and every digit comes from that integer.
+ *
+ * Negative values keep their sign, including ones between -1 and 0 (-0.25
+ * is "-0.25", not "0.25"), and the digits after the point keep their
+ * leading zeros (1.05 is "1.05", not "1.5"). A value that rounds to 0 is
+ * written without a sign. Values too large to write with that many decimals
+ * lose decimals until they fit; beyond that (about 4 billion), and for NaN,
+ * the text is "ovf" or "nan".
+ *
+ * @param buffer At least FORMAT_BUFFER characters
+ * @param value The number to write
+ * @param decimals Digits after the decimal point [0 - FORMAT_MAX_DECIMALS];
+ * with 0 there is no decimal point
+ * @param width Pads the text with spaces on the left to this many characters
+ * [0 - FORMAT_MAX_WIDTH]; 0 for no padding. Longer text is never cut.
+ * @returns The length of the text
+ *
+ * Example usage:
+ *
+ * @code
+ * char text[FORMAT_BUFFER];
+ * formatDecimal(text, -0.256, 2, 6); // " -0.26"
+ * @endcode
+ */
+int formatDecimal(char *buffer, double value, int decimals, int width = 0);
+
+#endif // SRC_KNW_KNWFORMAT_H_
@@ -0,0 +1,177 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  KNWHandles.cpp - Component handles that skip KNWRobot's id lookups.
+
+  Each handle keeps what KNWRobot would otherwise find again on every call
+  (the component, its slot, or its port) and calls the same private
+  helpers the id-based functions use, so both behave exactly alike.
+*/
+
+#include "KNWHandles.h"
+#include "KNWRobot.h"
+
+// ******************************************* //
+// Servos
+// ******************************************* //
+ServoHandle::ServoHandle(KNWRobot *robot, Motor *servo)
+{
+    this->robot = robot;
+    this->servo = servo;
+}
+
+bool ServoHandle::valid() const
+{
+    return servo != nullptr;
+}
+
+void ServoHandle::write(int angle)
+{
+    if (servo != nullptr)
+        robot->writeActuator(*servo, angle);
+}
+
+void ServoHandle::writeSpeed(int speed)
+{
+    if (servo != nullptr)
+        robot->pulseActuator(*servo, robot->contServoTicks(speed));
+}
+
+void ServoHandle::stop()
+{
+    if (servo != nullptr)
+        robot->writeActuator(*servo, servo->ZERO);
+}
+
+// ******************************************* //
+// DC Motors
+// ******************************************* //
+MotorHandle::MotorHandle(KNWRobot *robot, Motor *motor)
+{
+    this->robot = robot;
+    this->motor = motor;
+}
+
+bool MotorHandle::valid() const
+{
+    return motor != nullptr;
+}
+
+void MotorHandle::drive(int speed)
+{
+    if (motor != nullptr)
+        robot->writeActuator(*motor, speed);
+}
+
+void MotorHandle::stop()
+{
+    if (motor != nullptr)
+        robot->writeActuator(*motor, motor->ZERO);
+}
+
+// ******************************************* //
+// Ping Sensors
+// ******************************************* //
+PingHandle::PingHandle(KNWRobot *robot, PingSensor *sensor)
+{
+    this->robot = robot;
+    this->sensor = sensor;
+    slot = sensor != nullptr ? sensor - robot->pingSensors : 0;
+}
+
+bool PingHandle::valid() const
+{
+    return sensor != nullptr;
+}
+
+long PingHandle::read()
+{
+    if (sensor == nullptr)
+        return -1;
+    // Let a background ping finish so the two don't hear each other
+    robot->pingScheduler.wait();
+    return robot->pingScheduler.toCentimeters(sensor->SONAR->ping());
+}
+
+long PingHandle::readMM()
+{
+    if (sensor == nullptr)
+        return -1;
+    // Let a background ping finish so the two don't hear each other
+    robot->pingScheduler.wait();
+    return robot->pingScheduler.toMillimeters(sensor->SONAR->ping());
+}
+
+long PingHandle::cached() const
+{
+    if (sensor == nullptr)
+        return -1;
+    return robot->pingScheduler.distance(slot);
+}
+
+long PingHandle::filtered() const
+{
+    if (sensor == nullptr)
+        return -1;
+    return PingScheduler::roundToCm(robot->pingScheduler.filter(slot)->value());
+}
+
+// ******************************************* //
+// Bump Sensors
+// ******************************************* //
+BumpHandle::BumpHandle(int pin)
+{
+    this->pin = pin;
+#if defined(portInputRegister)
+    if (pin != -1)
+    {
+        input = portInputRegister(digitalPinToPort(pin));
+        mask = digitalPinToBitMask(pin);
+    }
+#endif
+}
+
+bool BumpHandle::valid() const
+{
+    return pin != -1;
+}
+
+bool BumpHandle::pressed() const
+{
+    if (pin == -1)
+        return false;
+#if defined(portInputRegister)
+    return (*input & mask) != 0;
+#else
+    return (bool)digitalRead(pin);
+#endif
+}
+
+// ******************************************* //
+// IR Sensors
+// ******************************************* //
+IRHandle::IRHandle(IRReceiver *receiver)
+{
+    this->receiver = receiver;
+}
+
+bool IRHandle::valid() const
+{
+    return receiver != nullptr;
+}
+
+int IRHandle::available()
+{
+    if (receiver == nullptr)
+        return -1;
+    if (!receiver->interruptDriven())
+        receiver->poll();
+    return receiver->available();
+}
+
+int IRHandle::read()
+{
+    if (receiver == nullptr)
+        return -1;
+    return receiver->read();
+}
@@ -0,0 +1,150 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_KNWHANDLES_H_
+#define SRC_KNW_KNWHANDLES_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+class KNWRobot;
+class IRReceiver;
+struct Motor;
+struct PingSensor;
+
+/*
+  Handles to components that have already been set up.
+
+  KNWRobot's functions take the id you gave a component and look it up on
+  every call. A handle does that lookup once (see KNWRobot::servoHandle()
+  and friends) and then goes straight to the component, which saves time in
+  loops that run thousands of times. A handle to an id that wasn't set up is
+  not valid(), and using it does nothing (reads return -1, or false for
+  pressed()).
+
+  Handles stay good for as long as the robot does, so get them once in
+  setup() and keep them.
+
+  Example usage:
+
+  @code
+  ServoHandle arm;
+  MotorHandle leftWheel;
+
+  void setup() {
+    myRobot->setupServo(1, 0);
+    myRobot->setupMotor(2, 1);
+    arm = myRobot->servoHandle(1);
+    leftWheel = myRobot->motorHandle(2);
+  }
+
+  void loop() {
+    arm.write(45);
+    leftWheel.drive(120);
+  }
+  @endcode
+*/
+
+class ServoHandle
+{
+public:
+     ServoHandle(KNWRobot *robot = nullptr, Motor *servo = nullptr);
+
+     bool valid() const;
+
+     // Same as KNWRobot::pca180Servo()
+     void write(int angle);
+
+     // Same as KNWRobot::pcaContServo()
+     void writeSpeed(int speed);
+
+     // Same as KNWRobot::pcaStop() for this servo
+     void stop();
+
+private:
+     KNWRobot *robot;
+     Motor *servo;
+};
+
+class MotorHandle
+{
+public:
+     MotorHandle(KNWRobot *robot = nullptr, Motor *motor = nullptr);
+
+     bool valid() const;
+
+     // Same as KNWRobot::pcaDCMotor()
+     void drive(int speed);
+
+     // Same as KNWRobot::pcaStop() for this motor
+     void stop();
+
+private:
+     KNWRobot *robot;
+     Motor *motor;
+};
+
+class PingHandle
+{
+public:
+     PingHandle(KNWRobot *robot = nullptr, PingSensor *sensor = nullptr);
+
+     bool valid() const;
+
+     // Same as KNWRobot::getPing()
+     long read();
+
+     // Same as KNWRobot::getPingMM()
+     long readMM();
+
+     // Same as KNWRobot::getPingCached()
+     long cached() const;
+
+     // Same as KNWRobot::getPingFiltered()
+     long filtered() const;
+
+private:
+     KNWRobot *robot;
+     PingSensor *sensor;
+     uint8_t slot;
+};
+
+class BumpHandle
+{
+public:
+     BumpHandle(int pin = -1);
+
+     bool valid() const;
+
+     // Same as KNWRobot::getBump()
+     bool pressed() const;
+
+private:
+     int pin;
+#if defined(portInputRegister)
+     // Read straight from the pin's port, without digitalRead()'s lookups
+     volatile uint8_t *input;
+     uint8_t mask;
+#endif
+};
+
+class IRHandle
+{
+public:
+     IRHandle(IRReceiver *receiver = nullptr);
+
+     bool valid() const;
+
+     // Same as KNWRobot::availableIR()
+     int available();
+
+     // Same as KNWRobot::readIR()
+     int read();
+
+private:
+     IRReceiver *receiver;
+};
+
+#endif // SRC_KNW_KNWHANDLES_H_
@@ -21,6 +21,7 @@
 #include <Keypad.h>
 #include <Adafruit_PWMServoDriver.h>
 #include <NewPing.h>
+#include <stdio.h>
 
 // PCA DETAILS (Calibrated by Prof Matt Saari)
 // Configuration parameters for each type of motor.
@@ -50,51 +51,76 @@
 #define PCA_DC_MIN PCA_DC_CENTER - PCA_DC_WIDTH
 #define PCA_DC_MAX PCA_DC_CENTER + PCA_DC_WIDTH
 
+// PCA board address and output frequency; pulse widths in ticks assume these
+#define PCA_ADDRESS 0x40
+#define PCA_FREQUENCY 60
+
 // IR DETAILS
-#define EVENT_RISING 1
-#define EVENT_FALLING 2
-#define EVENT_NONE 0
-#define IR_WAIT 100000
+// scanIR() listens this long, about as long as the old 100000-pass polling loop
+#define IR_SCAN_US 400000UL
+// Characters kept by one scan; an IRSensor's BUFFER has room for these plus a NUL
+#define IR_SCAN_CHARS 8
+// scanIRAll(true) waits this long after the first character for the other
+// sensors to finish decoding the same frame
+#define IR_FRAME_GRACE_US 2000UL
 
 // ******************************************* //
 // KNWRobot Constructor
 // ******************************************* //
-KNWRobot::KNWRobot(long lcdAddress = 0x27) // address can also be 0x3F
+KNWRobot::KNWRobot(long lcdAddress) // address can also be 0x3F
+{
+    // Room for the most components the robot supports
+    pingSensors = new PingSensor[KNW_MAX_PINGS];
+    maxPings = KNW_MAX_PINGS;
+    bumpSensors = new Component[KNW_MAX_BUMPS];
+    maxBumps = KNW_MAX_BUMPS;
+    irSensors = new IRSensor[KNW_MAX_IR];
+    maxIR = KNW_MAX_IR;
+    motors = new Motor[KNW_MAX_MOTORS];
+    maxMotors = KNW_MAX_MOTORS;
+    servos = new Motor[KNW_MAX_SERVOS];
+    maxServos = KNW_MAX_SERVOS;
+    ownsStorage = true;
+
+    init(lcdAddress);
+}
+
+KNWRobot::KNWRobot(const KNWStorage &storage, long lcdAddress)
+{
+    // Room for exactly what the config declared, never more than the robot supports
+    pingSensors = storage.pings;
+    maxPings = min(storage.maxPings, KNW_MAX_PINGS);
+    bumpSensors = storage.bumps;
+    maxBumps = min(storage.maxBumps, KNW_MAX_BUMPS);
+    irSensors = storage.irs;
+    maxIR = min(storage.maxIR, KNW_MAX_IR);
+    motors = storage.motors;
+    maxMotors = min(storage.maxMotors, KNW_MAX_MOTORS);
+    servos = storage.servos;
+    maxServos = min(storage.maxServos, KNW_MAX_SERVOS);
+    ownsStorage = false;
+
+    init(lcdAddress);
+}
+
+void KNWRobot::init(long lcdAddress)
 {
     // Set pointers to null to avoid seg fault on reset calls
     lcd = nullptr;
+    lcdBuffered = false;
     pwm = nullptr;
     keypad = nullptr;
 
-    // analog pins that can't be used
-    for (int i = 0; i < 16; i++)
-    {
-        if (i >= 2 && i < 4)
-        {
-            analogPins[i] = true;
-        }
-        else
-        {
-            analogPins[i] = false;
-        }
-    }
-
     // digital pins that can't be used (tx,rx)
-    memset(digitalPins, 0, sizeof(digitalPins));
     int commPins[] = {0, 1, 14, 15, 16, 17, 18, 19, 20, 21}; // 10 no-nos
     for (int i = 0; i < 10; i++)
     {
-        digitalPins[commPins[i]] = true;
+        pins.reserve('d', commPins[i], 'x');
     }
 
     // pins that can't be used because of the Conductivity
-    digitalPins[12] = true;
-    digitalPins[13] = true;
-    analogPins[2] = true;
-    analogPins[3] = true;
-
-    memset(pcaPins, 0, sizeof(pcaPins));
-	
+    pins.reserve('d', 12, 13, 'c');
+    pins.reserve('a', 2, 3, 'c');
 
     setupKeypad();
 
@@ -112,6 +138,23 @@ KNWRobot::~KNWRobot()
     delete keypad;
     delete lcd;
     delete pwm;
+    pingScheduler.stop();
+    for (int i = 0; i < numPings; i++)
+    {
+        delete pingSensors[i].SONAR;
+    }
+    for (int i = 0; i < numIR; i++)
+    {
+        irSensors[i].RECEIVER.end();
+    }
+    if (ownsStorage)
+    {
+        delete[] pingSensors;
+        delete[] bumpSensors;
+        delete[] irSensors;
+        delete[] motors;
+        delete[] servos;
+    }
 }
 
 // ******************************************* //
@@ -119,19 +162,18 @@ KNWRobot::~KNWRobot()
 // ******************************************* //
 void KNWRobot::setupKeypad()
 {
-    // setting up keypad
-    entered = false;
-    numEntered = 0;
+    // setting up keypad; its keys go to the line editor
     keypad = new Keypad(makeKeymap(keys), rowPins, colPins, ROWS, COLS);
+    keypadEditor.begin(keypad, &screen);
 
     for (int i = 0; i < ROWS; i++)
     {
-        digitalPins[rowPins[i]] = true;
+        pins.reserve('d', rowPins[i], 'k');
     }
 
     for (int i = 0; i < COLS; i++)
     {
-        digitalPins[colPins[i]] = true;
+        pins.reserve('d', colPins[i], 'k');
     }
 }
 
@@ -140,16 +182,21 @@ void KNWRobot::setupLCD(long lcdAddress)
     // setting up LCD
     lcd = new LiquidCrystal_I2C(lcdAddress, 2, 1, 0, 4, 5, 6, 7, 3, POSITIVE);
     lcd->begin(16, 2); // initialize the lcd
-    lcd->home();       // go to the top line
-    lcd->print("SMU Lyle ENGR 1357");
+    screen.begin(lcd); // starts at the top line
+    screen.print("SMU Lyle ENGR 1357");
+    screen.flush();
 }
 
 void KNWRobot::setupPWM()
 {
-    // setting up PWM board
-    pwm = new Adafruit_PWMServoDriver();
+    // setting up PWM board; actuators can only use it if it answers
+    Wire.begin();
+    Wire.beginTransmission(PCA_ADDRESS);
+    pcaPresent = Wire.endTransmission() == 0;
+
+    pwm = new Adafruit_PWMServoDriver(PCA_ADDRESS);
     pwm->begin();
-    pwm->setPWMFreq(60); // Analog servos run at ~60 Hz updates
+    pwm->setPWMFreq(PCA_FREQUENCY); // Analog servos run at ~60 Hz updates
 }
 
 void KNWRobot::setupSensors()
@@ -161,14 +208,28 @@ void KNWRobot::setupSensors()
     numBumps = 0;
     inclinePin = -1;
     tempPin = -1;
+
+    // analog sensors are read through the sampler once it is started
+    analogOversample = 1;
+    conductivityProbe.setSampler(&analogSampler);
+
+    // no timed motions yet
+    for (int i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        motions[i].action = -1;
+    }
 }
 
 void KNWRobot::setupIR()
 {
     // setting up IR handling
-    necState = 0;
-    prev_time = 0;
-    num_chars = 0;
+    numIR = 0;
+    lastIR = 0;
+    for (int i = 0; i < maxIR; i++)
+    {
+        memset(irSensors[i].BUFFER, 0, sizeof(irSensors[i].BUFFER));
+        irSensors[i].COUNT = 0;
+    }
 }
 
 // ******************************************* //
@@ -194,108 +255,142 @@ void KNWRobot::resetLCD(long lcdAddress)
 // ******************************************* //
 bool *KNWRobot::getAnalogPins()
 {
+    static bool analogPins[PIN_ANALOG_COUNT];
+    pins.fill('a', analogPins);
     return analogPins;
 }
 
 bool *KNWRobot::getDigitalPins()
 {
+    static bool digitalPins[PIN_DIGITAL_COUNT];
+    pins.fill('d', digitalPins);
     return digitalPins;
 }
 
 bool *KNWRobot::getPCAPins()
 {
+    static bool pcaPins[PIN_PCA_COUNT];
+    pins.fill('p', pcaPins);
     return pcaPins;
 }
 
-bool KNWRobot::checkPin(int pin, char type)
+char KNWRobot::getPinOwner(int pin, char type)
 {
-    if (type == 'a')
-    { // analog pins
-        if (pin < 16 && pin >= 0)
-        {
-            if (analogPins[pin] == false)
-            {
-                // if false then the pin is free
-                return true;
-            }
-        }
+    return pins.owner(type, pin);
+}
+
+bool KNWRobot::getPinConflict(char *line1, char *line2)
+{
+    line1[0] = '\0';
+    line2[0] = '\0';
+    if (!pins.conflict())
+        return false;
+
+    static const char owners[] = "ubrsmitxkc";
+    static const char *const names[] = {"Ping", "Bump", "IR", "Servo", "Motor", "Incline", "Temp",
+                                        "serial", "keypad", "conduct."};
+    const char *wanted = strchr(owners, pins.conflictWanted());
+    const char *owner = strchr(owners, pins.conflictOwner());
+    char space = pins.conflictSpace() - 'a' + 'A';
+
+    if (wanted == nullptr)
+        snprintf(line1, 17, "pin %c%d", space, pins.conflictPin());
+    else if (pins.conflictID() == -1)
+        snprintf(line1, 17, "%s pin %c%d", names[wanted - owners], space, pins.conflictPin());
+    else
+        snprintf(line1, 17, "%s %d pin %c%d", names[wanted - owners], pins.conflictID(), space, pins.conflictPin());
+
+    if (pins.conflictOwner() == 0)
+    {
+        snprintf(line2, 17, "no such pin");
     }
-    else if (type == 'd')
-    { // digital pins
-        if (pin < 54 && pin >= 0)
-        {
-            if (digitalPins[pin] == false)
-            {
-                // if false then the pin is free
-                return true;
-            }
-        }
+    else
+    {
+        int id = getPinOwnerID(pins.conflictPin(), pins.conflictSpace(), pins.conflictOwner());
+        if (id == -1)
+            snprintf(line2, 17, "%s has it", names[owner - owners]);
+        else
+            snprintf(line2, 17, "%s %d has it", names[owner - owners], id);
     }
-    else if (type == 'p' && pin >= 0)
-    { // pca pins
-        if (pin < 16)
-        {
-            if (pcaPins[pin] == false)
-            {
-                // if false then the pin is free
-                return true;
-            }
-        }
+    return true;
+}
+
+bool KNWRobot::printPinConflict()
+{
+    char line1[17], line2[17];
+    if (!getPinConflict(line1, line2))
+        return false;
+    screen.clear();
+    screen.print(line1);
+    screen.setCursor(0, 1);
+    screen.print(line2);
+    showLCD();
+    return true;
+}
+
+int KNWRobot::getPinOwnerID(int pin, char type, char owner)
+{
+    // Only runs to explain a conflict, so a scan is fine here
+    if (owner == 'u')
+    {
+        for (int i = 0; i < numPings; i++)
+            if (pingSensors[i].TRIG == pin || pingSensors[i].ECHO == pin)
+                return pingSensors[i].ID;
     }
-    return false;
+    else if (owner == 'b')
+    {
+        for (int i = 0; i < numBumps; i++)
+            if (bumpSensors[i].PIN == pin)
+                return bumpSensors[i].ID;
+    }
+    else if (owner == 'r')
+    {
+        for (int i = 0; i < numIR; i++)
+            if (irSensors[i].PIN == pin)
+                return irSensors[i].ID;
+    }
+    else if (owner == 's')
+    {
+        for (int i = 0; i < numServos; i++)
+            if (servos[i].PIN == pin && servos[i].TYPE == type)
+                return servos[i].ID;
+    }
+    else if (owner == 'm')
+    {
+        for (int i = 0; i < numMotors; i++)
+            if (motors[i].PIN == pin && motors[i].TYPE == type)
+                return motors[i].ID;
+    }
+    return -1;
 }
 
 int KNWRobot::getPin(int id, char type)
 {
+    int slot;
     if (type == 'p')
     { // ping sensors
-        for (int i = 0; i < numPings; i++)
-        {
-            if (pingSensors[i].ID == id)
-            {
-                return pingSensors[i].TRIG;
-            }
-        }
+        slot = pingIndex.find(id);
+        return slot == -1 ? -1 : pingSensors[slot].TRIG;
     }
     else if (type == 'b')
     { // bump sensors
-        for (int i = 0; i < numBumps; i++)
-        {
-            if (bumpSensors[i].ID == id)
-            {
-                return bumpSensors[i].PIN;
-            }
-        }
+        slot = bumpIndex.find(id);
+        return slot == -1 ? -1 : bumpSensors[slot].PIN;
     }
     else if (type == 'm')
     { // DC motors
-        for (int i = 0; i < numMotors; i++)
-        {
-            if (motors[i].ID == id)
-            {
-                return motors[i].PIN;
-            }
-        }
+        slot = motorIndex.find(id);
+        return slot == -1 ? -1 : motors[slot].PIN;
     }
     else if (type == 's')
     { // servos
-        for (int i = 0; i < numServos; i++)
-        {
-            if (servos[i].ID == id)
-            {
-                return servos[i].PIN;
-            }
-        }
+        slot = servoIndex.find(id);
+        return slot == -1 ? -1 : servos[slot].PIN;
     }
     else if (type == 'r')
     { // IR sensors
-        for (int i = 0; i < numIR; i++)
-        {
-            if (irSensors[i].ID == id)
-            {
-                return irSensors[i].PIN;
-            }
-        }
+        slot = irIndex.find(id);
+        return slot == -1 ? -1 : irSensors[slot].PIN;
     }
     return -1; // default no PIN found
 }
@@ -304,48 +399,130 @@ int KNWRobot::getPin(int id, char type)
 // Ping Sensor Functions
 // ******************************************* //
 int KNWRobot::getTrig(int id){
-    for(int i = 0; i < numPings; i++){
-        if (pingSensors[i].ID == id)
-            return pingSensors[i].TRIG;
-    }
+    PingSensor *sensor = getPingSensor(id);
+    if (sensor == nullptr)
+        return -1;
+    return sensor->TRIG;
 }
 
 int KNWRobot::getEcho(int id){
-    for(int i = 0; i < numPings; i++){
-        if (pingSensors[i].ID == id)
-            return pingSensors[i].ECHO;
-    }
+    PingSensor *sensor = getPingSensor(id);
+    if (sensor == nullptr)
+        return -1;
+    return sensor->ECHO;
 }
 
-bool KNWRobot::setupPing(int id, int trigger, int echo)
+bool KNWRobot::setupPing(int id, int trigger, int echo, int maxDistance)
 {
-    if (checkPin(trigger, 'd') && numPings < 8)
+    if (numPings < maxPings && maxDistance > 0 && pins.reserve('d', trigger, echo, 'u', id))
     {
         // set the trigger pin
         pingSensors[numPings].ID = id;
         pingSensors[numPings].TRIG = trigger;
         pingSensors[numPings].ECHO = echo;
         pingSensors[numPings].TYPE = 'd';
+        pingSensors[numPings].MAX_DISTANCE = maxDistance;
+        // Resolve the port registers once instead of on every ping
+        pingSensors[numPings].SONAR = new NewPing(trigger, echo, maxDistance);
+        pingIndex.add(id, numPings);
         numPings++;
-        digitalPins[trigger] = true;
-        digitalPins[echo] = true;
         return true;
     }
     return false;
 }
 
+PingSensor *KNWRobot::getPingSensor(int id)
+{
+    int slot = pingIndex.find(id);
+    if (slot == -1)
+        return nullptr;
+    return &pingSensors[slot];
+}
+
+bool KNWRobot::setPingMaxDistance(int id, int maxDistance)
+{
+    PingSensor *sensor = getPingSensor(id);
+    if (sensor == nullptr || maxDistance <= 0)
+        return false;
+    if (sensor->MAX_DISTANCE != maxDistance)
+    {
+        // Don't leave a background ping timing the old instance
+        pingScheduler.clear(sensor - pingSensors);
+        delete sensor->SONAR;
+        sensor->SONAR = new NewPing(sensor->TRIG, sensor->ECHO, maxDistance);
+        sensor->MAX_DISTANCE = maxDistance;
+    }
+    return true;
+}
+
 // Check out this site for implementation details:
 long KNWRobot::getPing(int id)
 {
-    int TRIGGER_PIN = getTrig(id);
-    int ECHO_PIN = getEcho(id);
-    int MAX_PING_DISTANCE = 200; // centimeters
+    return pingHandle(id).read();
+}
+
+long KNWRobot::getPingMM(int id)
+{
+    return pingHandle(id).readMM();
+}
+
+bool KNWRobot::setPingTemperature(int tenthsC)
+{
+    return pingScheduler.setTemperature(tenthsC);
+}
+
+bool KNWRobot::startPings(int intervalMs)
+{
+    if (intervalMs < 0)
+        return false;
+    return pingScheduler.start(pingSensors, numPings, intervalMs);
+}
+
+void KNWRobot::stopPings()
+{
+    pingScheduler.stop();
+}
+
+long KNWRobot::getPingCached(int id)
+{
+    return pingHandle(id).cached();
+}
+
+long KNWRobot::getPingCachedMM(int id)
+{
+    PingSensor *sensor = getPingSensor(id);
+    if (sensor == nullptr)
+        return -1;
+    return pingScheduler.distanceMm(sensor - pingSensors);
+}
 
-    if (TRIGGER_PIN == -1 || ECHO_PIN == -1)
-        return -1; // Ping sensor has not been set up properly; this is an invalid ID
+unsigned long KNWRobot::getPingTime(int id)
+{
+    PingSensor *sensor = getPingSensor(id);
+    if (sensor == nullptr)
+        return 0;
+    return pingScheduler.time(sensor - pingSensors);
+}
 
-    NewPing pingSensor(TRIGGER_PIN, ECHO_PIN, MAX_PING_DISTANCE);
-    return pingSensor.ping_cm();
+bool KNWRobot::setPingFilter(int id, char type, int window)
+{
+    PingSensor *sensor = getPingSensor(id);
+    if (sensor == nullptr || window < 1 || window > PING_WINDOW_MAX)
+        return false;
+    return pingScheduler.filter(sensor - pingSensors)->setType(type, window);
+}
+
+long KNWRobot::getPingFiltered(int id)
+{
+    return pingHandle(id).filtered();
+}
+
+int KNWRobot::getPingValid(int id)
+{
+    PingSensor *sensor = getPingSensor(id);
+    if (sensor == nullptr)
+        return -1;
+    return pingScheduler.filter(sensor - pingSensors)->valid();
 }
 
 // ******************************************* //
@@ -353,13 +530,13 @@ long KNWRobot::getPing(int id)
 // ******************************************* //
 bool KNWRobot::setupBump(int id, int pin)
 {
-    if (checkPin(pin, 'd') && numBumps < 8)
+    if (numBumps < maxBumps && pins.reserve('d', pin, 'b', id))
     {
         bumpSensors[numBumps].ID = id;
         bumpSensors[numBumps].PIN = pin;
         bumpSensors[numBumps].TYPE = 'd';
+        bumpIndex.add(id, numBumps);
         numBumps++;
-        digitalPins[pin] = true;
         return true;
     }
     return false;
@@ -367,10 +544,7 @@ bool KNWRobot::setupBump(int id, int pin)
 
 bool KNWRobot::getBump(int id)
 {
-    int pin = getPin(id, 'b');
-    if (pin == -1)
-        return false; // not a valid ID
-    return (bool)digitalRead(pin);
+    return bumpHandle(id).pressed();
 }
 
 // ******************************************* //
@@ -378,10 +552,10 @@ bool KNWRobot::getBump(int id)
 // ******************************************* //
 bool KNWRobot::setupIncline(int pin)
 {
-    if (checkPin(pin, 'a'))
+    if (pins.reserve('a', pin, 'i'))
     {
         inclinePin = pin;
-        analogPins[pin] = true;
+        analogSampler.add(pin, analogOversample);
         return true;
     }
     return false;
@@ -391,135 +565,169 @@ int KNWRobot::getIncline()
 {
     if (inclinePin == -1)
         return -1;
-    return analogRead(inclinePin);
+    return analogSampler.sample(inclinePin);
+}
+
+bool KNWRobot::startAnalogSampling(int oversample)
+{
+    if (oversample < 1 || oversample > ANALOG_MAX_OVERSAMPLE)
+        return false;
+    if (inclinePin != -1 && !analogSampler.add(inclinePin, oversample))
+        return false;
+    if (tempPin != -1 && !analogSampler.add(tempPin, oversample))
+        return false;
+    analogOversample = oversample;
+    return analogSampler.start();
+}
+
+void KNWRobot::stopAnalogSampling()
+{
+    analogSampler.stop();
 }
 
 // ******************************************* //
-// Conductivity Functions
+// Temperature Functions
 // ******************************************* //
-int KNWRobot::getConductivity()
+bool KNWRobot::setupTemp(int pin)
 {
-    const unsigned long seconds = 3;
+    if (pins.reserve('a', pin, 't'))
+    {
+        tempPin = pin;
+        analogSampler.add(pin, analogOversample);
+        temperatureProbe.begin(pin, &analogSampler);
+        return true;
+    }
+    return false;
+}
 
-    const int conductivityDigitalPin1 = 12;
-    const int conductivityDigitalPin2 = 13;
-    const int conductivityAnalogPin1 = 2;
-    const int conductivityAnalogPin2 = 3;
+int KNWRobot::getTemp()
+{
+    // Sketches that never call update() still get new readings
+    updateTemperature();
+    return temperatureProbe.raw();
+}
 
-    int reading1, reading2, result;
+bool KNWRobot::calibrateTemp(int raw1, int tenthsC1, int raw2, int tenthsC2)
+{
+    if (!temperatureProbe.calibrate(raw1, tenthsC1, raw2, tenthsC2))
+        return false;
+    if (temperatureProbe.started())
+        pingScheduler.setTemperature(temperatureProbe.tenthsC());
+    return true;
+}
 
-    // One period of the wave is 10ms. So we want to
-    // repeat it numMilliseconds/10ms times
-    unsigned long loopCount = (seconds)*100ul;
+int KNWRobot::getTempTenthsC()
+{
+    updateTemperature();
+    return temperatureProbe.tenthsC();
+}
 
-    pinMode(conductivityDigitalPin1, OUTPUT);
-    pinMode(conductivityDigitalPin2, OUTPUT);
-    digitalWrite(conductivityDigitalPin1, HIGH);
-    digitalWrite(conductivityDigitalPin2, HIGH);
+// Takes a temperature reading when one is due
+void KNWRobot::updateTemperature()
+{
+    // A new temperature also corrects the pings' speed of sound
+    if (temperatureProbe.update() && temperatureProbe.calibrated())
+        pingScheduler.setTemperature(temperatureProbe.tenthsC());
+}
 
-    // We make an alternating-phase square wave out of digital pins 12/13
-    // For this to work, we needed simultaneous digital pin writes. Refer to
-    // http://www.arduino.cc/en/Reference/PortManipulation
-    for (unsigned long i = 0; i < loopCount; ++i)
+// ******************************************* //
+// Conductivity Functions
+// ******************************************* //
+int KNWRobot::getConductivity()
+{
+    // Same 3 second, 100Hz measurement as always, waiting for it to finish
+    if (!startConductivity())
+        return -1;
+    unsigned long start = millis();
+    while (!conductivityReady())
     {
-        // The AND turns off pin 13, OR turns on pin 12
-        PORTB = B01000000 | (PORTB & B01111111);
-        delay(5);
-
-        // AND turns off pin 12, OR turns on pin 13
-        PORTB = B10000000 | (PORTB & B10111111);
-        delay(5);
+        if (millis() - start > CONDUCTIVITY_DURATION_MS + CONDUCTIVITY_WAIT_MARGIN_MS)
+        {
+            conductivityProbe.stop();
+            return -1;
+        }
     }
+    return conductivityResult();
+}
+
+bool KNWRobot::startConductivity(unsigned long durationMs, int frequency)
+{
+    return conductivityProbe.start(durationMs, frequency);
+}
 
-    reading1 = analogRead(conductivityAnalogPin1);
-    reading2 = analogRead(conductivityAnalogPin2);
-    digitalWrite(conductivityDigitalPin1, LOW);
-    digitalWrite(conductivityDigitalPin2, LOW);
+bool KNWRobot::conductivityReady()
+{
+    return conductivityProbe.ready();
+}
 
-    return result = abs(reading1 - reading2);
+int KNWRobot::conductivityResult()
+{
+    return conductivityProbe.result();
 }
 // ******************************************* //
 // Keypad Functions
 // ******************************************* //
 int KNWRobot::getKeypadInput()
 {
-    lcd->clear();
+    screen.clearNow();
     return getKeypadInput(0);
 }
 
 int KNWRobot::getKeypadInput(int row)
 {
-    int inInt = -1;
-    char key;
-    bool letterflag = false;
-    char letter;
-
-    // to get multi input from keypad into int
-    while (!entered)
+    // The same editor as startKeypadInput(), waited on; update() picks up the
+    // keys and keeps the robot's background tasks running meanwhile
+    keypadEditor.start('a', KEYPAD_MAX_LENGTH, row, 0);
+    while (keypadEditor.state() != KEYPAD_DONE)
     {
-        key = keypad->getKey();
-        if (key)
-        {
-            lcd->setCursor(numEntered, row);
-            lcd->print(key);
+        // There is nothing to cancel here, so '*' on an empty line does nothing
+        if (keypadEditor.state() != KEYPAD_EDITING)
+            keypadEditor.start('a', KEYPAD_MAX_LENGTH, row, 0);
+        update();
+        // Echo right away, even when the LCD is buffered
+        screen.flush();
+    }
+    return keypadEditor.result();
+}
 
-            // max input is 16, neglects most recent and enters
-            if (key == '#' || numEntered == 16)
-            {
-                DATA[numEntered] = '\0'; // null temrinator for atoi conversion
-                entered = true;
-            }
-            else if (key == '*' && numEntered > 0)
-            { // backspace
-                numEntered--;
-                lcd->setCursor(numEntered, row);
-                lcd->print(" ");
-            }
-            else if (key != '#' && key != '*')
-            {
-                DATA[numEntered] = key;
-                numEntered++;
-            }
-            if (key == 'A' || key == 'B' || key == 'C' || key == 'D')
-            {
-                letterflag = true;
-                letter = key;
-            }
-        }
+bool KNWRobot::startKeypadInput(int row, char mode, int maxLength)
+{
+    return keypadEditor.start(mode, maxLength, row, 0);
+}
 
-        if (entered)
-        {
-            if (letterflag)
-            {
-                inInt = (int)letter;
-            }
-            else
-            {
-                inInt = atoi(DATA);
-            }
-            memset(DATA, 0, sizeof(DATA));
-            numEntered = 0;
-        }
-    } // end while
+char KNWRobot::keypadInputState()
+{
+    return keypadEditor.state();
+}
+
+int KNWRobot::keypadInputResult()
+{
+    return keypadEditor.result();
+}
 
-    entered = false;
-    return inInt; // returns -1 if nothing pressed
+void KNWRobot::stopKeypadInput()
+{
+    keypadEditor.cancel();
 }
 
 void KNWRobot::secretFunction()
 {
-    lcd->clear();
-    lcd->print("This B Empty");
+    screen.clear();
+    screen.print("This B Empty");
+    screen.setCursor(0, 1);
+    screen.print("YEEEEEEEETT");
+    showLCD();
+
+    // Stage every output and send them together so they all move at once
     for (int i = 0; i < numServos; i++)
     {
-        pwm->setPWM(servos[i].PIN, 0, PCA_SERVO_180_MIN + (i + 1) * 40);
+        pulseActuator(servos[i], PCA_SERVO_180_MIN + (i + 1) * 40, true);
     }
-    lcd->setCursor(0, 1);
-    lcd->print("YEEEEEEEETT");
     for (int i = 0; i < numMotors; i++)
     {
-        pwm->setPWM(motors[i].PIN, 0, PCA_SERVO_180_MIN + (i + 1) * 40);
+        pulseActuator(motors[i], PCA_SERVO_180_MIN + (i + 1) * 40, true);
     }
+    pwm->flushPWM();
 }
 
 // ******************************************* //
@@ -527,36 +735,45 @@ void KNWRobot::secretFunction()
 // ******************************************* //
 void KNWRobot::clearLCD()
 {
-    lcd->clear();
+    // One clear command beats blanking each character when it is sent right
+    // away; it doesn't wait for the LCD, the next change sent does
+    if (lcdBuffered)
+        screen.clear();
+    else
+        screen.clearNow();
 }
 
 void KNWRobot::moveCursor(int col, int row)
 {
-    lcd->setCursor(col, row);
+    screen.setCursor(col, row);
 }
 
 void KNWRobot::clearLine(int row)
 {
-    lcd->setCursor(0, row);
-    lcd->print("                "); // 16 characters
-    lcd->setCursor(0, row);
+    screen.setCursor(0, row);
+    screen.print("                "); // 16 characters
+    screen.setCursor(0, row);
+    showLCD();
 }
 
 void KNWRobot::printLCD(char *input)
 {
-    lcd->print(input);
+    screen.print(input);
+    showLCD();
 }
 
 void KNWRobot::printLCD(double input, short decimalPlaces)
 {
-    long multiplier = pow(10, decimalPlaces);
-    long wholeValue = (long)input;
-    printLCD(wholeValue);             //whole number value
-    printLCD('.');                    //decimal point
-    input -= wholeValue;              //gives us just the digits after the decimal
-    input *= multiplier;              //put digits we want to print in front of decimal
-    long decimalDigits = (long)input; //discard everything we won't use
-    printLCD(abs(decimalDigits));          //print remaining digits as param specifies
+    printLCD(input, decimalPlaces, (short)0);
+}
+
+void KNWRobot::printLCD(double input, short decimalPlaces, short width)
+{
+    // Formatted on the stack and sent as one run
+    char text[FORMAT_BUFFER];
+    formatDecimal(text, input, decimalPlaces, width);
+    screen.print(text);
+    showLCD();
 }
 
 void KNWRobot::printLCD(double input)
@@ -566,185 +783,246 @@ void KNWRobot::printLCD(double input)
 
 void KNWRobot::printLCD(int input)
 {
-    lcd->print(input);
+    screen.print(input);
+    showLCD();
 }
 
 void KNWRobot::printLCD(long input)
 {
-    lcd->print(input);
+    screen.print(input);
+    showLCD();
 }
 
 void KNWRobot::printLCD(char input)
 {
-    lcd->print(input);
+    screen.print(input);
+    showLCD();
+}
+
+void KNWRobot::bufferLCD(bool buffered)
+{
+    lcdBuffered = buffered;
+    showLCD();
+}
+
+int KNWRobot::flushLCD()
+{
+    return screen.flush();
+}
+
+bool KNWRobot::lcdPending()
+{
+    return screen.pending();
+}
+
+void KNWRobot::showLCD()
+{
+    if (!lcdBuffered)
+        screen.flush();
 }
 
 // ******************************************* //
 // PCA9685 Board Functions
 // ******************************************* //
-bool KNWRobot::setupServo(int id, int pin, int zero)
+bool KNWRobot::setupServo(int id, int pin, int zero, char type)
 {
-    if (checkPin(pin, 'd') && numServos < 16)
+    if (numServos < maxServos && setupActuator(servos[numServos], id, pin, zero, type, 's'))
     {
-        servos[numServos].ID = id;
-        servos[numServos].PIN = pin;
-        servos[numServos].TYPE = 'd';
-        servos[numServos].ZERO = zero;
-        servos[numServos].OBJ.attach(pin);
+        servoIndex.add(id, numServos);
         numServos++;
-        digitalPins[pin] = true;
         return true;
-
     }
     return false;
 }
 
-bool KNWRobot::setupMotor(int id, int pin, int zero)
+bool KNWRobot::setupMotor(int id, int pin, int zero, char type)
 {
-    if (checkPin(pin, 'd') && numMotors < 4)
+    if (numMotors < maxMotors && setupActuator(motors[numMotors], id, pin, zero, type, 'm'))
     {
-        motors[numMotors].ID = id;
-        motors[numMotors].PIN = pin;
-        motors[numMotors].TYPE = 'd';
-        motors[numMotors].ZERO = zero;
-        motors[numMotors].OBJ.attach(pin);
+        motorIndex.add(id, numMotors);
         numMotors++;
-        digitalPins[pin] = true;
         return true;
     }
     return false;
 }
 
-void KNWRobot::pcaStop(int id, char type)
+bool KNWRobot::setupActuator(Motor &actuator, int id, int pin, int zero, char type, char owner)
 {
-    int pin = getPin(id, type);
-    if (pin != -1) {
-        if (type == 's') {
-            int angle = 90;
-            for (int i = 0; i < numServos; i++) {
-                if (servos[i].ID == id)
-                    angle = servos[i].ZERO;
-            }
-            pca180Servo(id, angle);
-        }
-        else if (type == 'm') {
-            int speed = 90;
-            for (int i = 0; i < numMotors; i++) {
-                if (motors[i].ID == id)
-                    speed = motors[i].ZERO;
-            }
-            pcaDCMotor(id, speed);
+    if (type == 'p')
+    {
+        // PCA board channel: the board makes the pulses, no timer needed
+        if (!pcaPresent || !pins.reserve('p', pin, owner, id))
+            return false;
+    }
+    else if (type == 'd')
+    {
+        // Digital pin driven by the Servo library's timer interrupt
+        if (!pins.reserve('d', pin, owner, id))
+            return false;
+        actuator.OBJ.attach(pin);
+    }
+    else
+    {
+        return false;
+    }
+    actuator.ID = id;
+    actuator.PIN = pin;
+    actuator.TYPE = type;
+    actuator.ZERO = zero;
+    return true;
+}
+
+Motor *KNWRobot::getActuator(int id, char type)
+{
+    int slot;
+    if (type == 's')
+    {
+        slot = servoIndex.find(id);
+        return slot == -1 ? nullptr : &servos[slot];
+    }
+    else if (type == 'm')
+    {
+        slot = motorIndex.find(id);
+        return slot == -1 ? nullptr : &motors[slot];
+    }
+    return nullptr;
+}
+
+// Sends a Servo::write() style value (an angle, or a pulse width in us) to
+// either backend. With stage set, PCA outputs wait for pwm->flushPWM().
+void KNWRobot::writeActuator(Motor &actuator, int value, bool stage)
+{
+    if (actuator.TYPE == 'd')
+    {
+        if (!actuator.OBJ.attached())
+            actuator.OBJ.attach(actuator.PIN);
+        actuator.OBJ.write(value);
+        return;
+    }
+
+    int us;
+    if (value < MIN_PULSE_WIDTH)
+        us = map(constrain(value, 0, 180), 0, 180, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+    else
+        us = constrain(value, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+    pulseActuator(actuator, (long)us * 4096L * PCA_FREQUENCY / 1000000L, stage);
+}
+
+// Sends a pulse width in PCA ticks (4096 per period) to either backend.
+// 0 turns the pulses off.
+void KNWRobot::pulseActuator(Motor &actuator, int ticks, bool stage)
+{
+    // One period at most, which also keeps the conversion below in an unsigned long
+    ticks = constrain(ticks, 0, 4095);
+    if (actuator.TYPE == 'd')
+    {
+        if (ticks == 0)
+        {
+            actuator.OBJ.detach();
+            return;
         }
+        if (!actuator.OBJ.attached())
+            actuator.OBJ.attach(actuator.PIN);
+        actuator.OBJ.writeMicroseconds((unsigned long)ticks * 1000000UL / (4096UL * PCA_FREQUENCY));
+        return;
     }
+
+    if (stage)
+        pwm->stagePWM(actuator.PIN, 0, ticks);
+    else
+        pwm->setPWM(actuator.PIN, 0, ticks);
+}
+
+void KNWRobot::pcaStop(int id, char type)
+{
+    Motor *actuator = getActuator(id, type);
+    if (actuator != nullptr)
+        writeActuator(*actuator, actuator->ZERO);
 }
 
 void KNWRobot::pcaStopAll() {
+    // PCA outputs are staged so they all stop in the same write
     for (int i = 0; i < numServos; i++) {
-        pcaStop(servos[i].ID, 's');
+        writeActuator(servos[i], servos[i].ZERO, true);
     }
     for (int i = 0; i < numMotors; i++) {
-        pcaStop(motors[i].ID, 'm');
+        writeActuator(motors[i], motors[i].ZERO, true);
     }
+    if (pwm != nullptr)
+        pwm->flushPWM();
 }
 
 void KNWRobot::pca180Servo(int id, int angle)
 {
-    int pin = getPin(id, 's');
-    if (pin != -1)
-    { // not a valid ID
-        for (int i = 0; i < numServos; i++) {
-            if (servos[i].ID == id)
-                servos[i].OBJ.write(angle);
-        }
-    }
+    servoHandle(id).write(angle);
 }
 
-void KNWRobot::pcaContServo(int id, int speed)
+// Take input from [-90,90] and map to PWM duty cycle scale out of 4095
+int KNWRobot::contServoTicks(int speed)
 {
-    int pin = getPin(id, 's');
-    if (pin != -1)
-    {
-        // Take input from [-90,90] and map to PWM duty cycle scale out of 4095
-        // Note, map() is used to flip direction.
-        int pulselen = map(
-            speed,
-            -1 * PCA_SERVO_CONTINUOUS_INPUT_RANGE,
-            PCA_SERVO_CONTINUOUS_INPUT_RANGE,
-            PCA_SERVO_CONTINUOUS_MAX,
-            PCA_SERVO_CONTINUOUS_MIN);
+    // Note, map() is used to flip direction.
+    int pulselen = map(
+        speed,
+        -1 * PCA_SERVO_CONTINUOUS_INPUT_RANGE,
+        PCA_SERVO_CONTINUOUS_INPUT_RANGE,
+        PCA_SERVO_CONTINUOUS_MAX,
+        PCA_SERVO_CONTINUOUS_MIN);
+
+    // Shift to range of; PWM Signal: 1ms - 2ms will give
+    // full reverse to full forward, 1.5ms is neutral
+    return constrain(
+        pulselen,
+        PCA_SERVO_CONTINUOUS_MIN,
+        PCA_SERVO_CONTINUOUS_MAX);
+}
 
-        // Shift to range of; PWM Signal: 1ms - 2ms will give
-        // full reverse to full forward, 1.5ms is neutral
-        pulselen = constrain(
-            pulselen,
-            PCA_SERVO_CONTINUOUS_MIN,
-            PCA_SERVO_CONTINUOUS_MAX);
-        pwm->setPWM(pin, 0, pulselen);
-    }
+void KNWRobot::pcaContServo(int id, int speed)
+{
+    servoHandle(id).writeSpeed(speed);
 }
 
 void KNWRobot::pcaDCMotor(int id, int speed)
 {
-    int pin = getPin(id, 'm');
-    if (pin != -1)
-    { // not a valid ID
-        for (int i = 0; i < numMotors; i++) {
-            if (motors[i].ID == id)
-                motors[i].OBJ.write(speed);
-        }
-    }
+    motorHandle(id).drive(speed);
 }
 
 void KNWRobot::pcaDC2Motors(int id1, int speed1, int id2, int speed2)
 {
-    int pin1 = getPin(id1, 'm');
-    int pin2 = getPin(id2, 'm');
-    if (pin1 != -1 && pin2 != 1)
+    Motor *motor1 = getActuator(id1, 'm');
+    Motor *motor2 = getActuator(id2, 'm');
+    if (motor1 != nullptr && motor2 != nullptr)
     {
-        for (int i = 0; i < numMotors; i++) {
-            if (motors[i].ID == id1)
-                motors[i].OBJ.write(speed1);
-            if (motors[i].ID == id2)
-                motors[i].OBJ.write(speed2);
-        }
+        // Both wheels change speed in the same PCA write
+        writeActuator(*motor1, speed1, true);
+        writeActuator(*motor2, speed2, true);
+        pwm->flushPWM();
     }
 }
 
 void KNWRobot::pca180ServoTime(int id, int angle, int duration)
 {
+    cancelMotions(getActuator(id, 's'));
     pca180Servo(id, angle);
-    delay(duration);
+    waitFor(duration);
 }
 
 void KNWRobot::pcaContServoTime(int id, int speed, int duration)
 {
-    int pin = getPin(id, 's');
-    if (pin != -1)
+    Motor *servo = getActuator(id, 's');
+    if (servo != nullptr)
     {
-        int pulselen = map(
-            speed,
-            -1 * PCA_SERVO_CONTINUOUS_INPUT_RANGE,
-            PCA_SERVO_CONTINUOUS_INPUT_RANGE,
-            PCA_SERVO_CONTINUOUS_MAX,
-            PCA_SERVO_CONTINUOUS_MIN);
-
-        pulselen = constrain(
-            pulselen,
-            PCA_SERVO_CONTINUOUS_MIN,
-            PCA_SERVO_CONTINUOUS_MAX);
-
-        pwm->setPWM(pin, 0, pulselen);
-
-        delay(duration);
-
-        pwm->setPWM(pin, 0, 0);
+        cancelMotions(servo);
+        pulseActuator(*servo, contServoTicks(speed));
+        waitFor(duration);
+        pulseActuator(*servo, 0);
     }
 }
 
 void KNWRobot::pcaDCMotorTime(int id, int speed, int duration)
 {
+    cancelMotions(getActuator(id, 'm'));
     pcaDCMotor(id, speed);
-    delay(duration);
+    waitFor(duration);
     pcaStop(id, 'm');
 }
 
@@ -755,160 +1033,350 @@ void KNWRobot::pcaDC2MotorsTime(
     int speed2,
     int duration)
 {
-
+    cancelMotions(getActuator(id1, 'm'));
+    cancelMotions(getActuator(id2, 'm'));
     pcaDC2Motors(id1, speed1, id2, speed2);
-    delay(duration);
+    waitFor(duration);
     pcaStop(id1, 'm');
     pcaStop(id2, 'm');
 }
 
+// ******************************************* //
+// Timed Actions
+// ******************************************* //
+void KNWRobot::update()
+{
+    analogSampler.poll();
+    // Only does anything where the probe has no timer interrupt
+    conductivityProbe.running();
+    updateTemperature();
+    pingScheduler.update();
+    scheduler.update();
+    keypadEditor.poll();
+    // Keys typed are echoed like anything else printed
+    if (lcdBuffered)
+        screen.step();
+    else
+        screen.flush();
+}
+
+int KNWRobot::pca180ServoTimeAsync(int id, int angle, int duration, void (*done)())
+{
+    Motor *servo = getActuator(id, 's');
+    if (servo == nullptr)
+        return -1;
+    int action = startMotion(servo, nullptr, 'h', duration, done);
+    if (action != -1)
+        writeActuator(*servo, angle);
+    return action;
+}
+
+int KNWRobot::pcaContServoTimeAsync(int id, int speed, int duration, void (*done)())
+{
+    Motor *servo = getActuator(id, 's');
+    if (servo == nullptr)
+        return -1;
+    int action = startMotion(servo, nullptr, 'o', duration, done);
+    if (action != -1)
+        pulseActuator(*servo, contServoTicks(speed));
+    return action;
+}
+
+int KNWRobot::pcaDCMotorTimeAsync(int id, int speed, int duration, void (*done)())
+{
+    Motor *motor = getActuator(id, 'm');
+    if (motor == nullptr)
+        return -1;
+    int action = startMotion(motor, nullptr, 's', duration, done);
+    if (action != -1)
+        writeActuator(*motor, speed);
+    return action;
+}
+
+int KNWRobot::pcaDC2MotorsTimeAsync(
+    int id1,
+    int speed1,
+    int id2,
+    int speed2,
+    int duration,
+    void (*done)())
+{
+    Motor *motor1 = getActuator(id1, 'm');
+    Motor *motor2 = getActuator(id2, 'm');
+    if (motor1 == nullptr || motor2 == nullptr)
+        return -1;
+    int action = startMotion(motor1, motor2, 's', duration, done);
+    if (action != -1)
+        pcaDC2Motors(id1, speed1, id2, speed2);
+    return action;
+}
+
+int KNWRobot::runAfter(unsigned long delayMs, void (*task)())
+{
+    return scheduler.after(delayMs, task);
+}
+
+int KNWRobot::runEvery(unsigned long periodMs, void (*task)())
+{
+    return scheduler.every(periodMs, task);
+}
+
+bool KNWRobot::actionDone(int action)
+{
+    return !scheduler.pending(action);
+}
+
+bool KNWRobot::cancelAction(int action)
+{
+    if (!scheduler.cancel(action))
+        return false;
+    for (int i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        if (motions[i].action == action)
+            motions[i].action = -1;
+    }
+    return true;
+}
+
+int KNWRobot::startMotion(Motor *first, Motor *second, char end, int duration, void (*done)())
+{
+    // A new timed motion replaces any earlier one on the same actuators
+    cancelMotions(first);
+    cancelMotions(second);
+
+    for (int i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        TimedMotion &motion = motions[i];
+        if (motion.action != -1)
+            continue;
+        motion.action = scheduler.after(duration > 0 ? duration : 0, finishMotion, &motion);
+        if (motion.action == -1)
+            return -1;
+        motion.robot = this;
+        motion.first = first;
+        motion.second = second;
+        motion.end = end;
+        motion.done = done;
+        return motion.action;
+    }
+    return -1;
+}
+
+void KNWRobot::finishMotion(void *context)
+{
+    TimedMotion *motion = (TimedMotion *)context;
+    KNWRobot *robot = motion->robot;
+    motion->action = -1;
+
+    // Both motors of a pair stop in the same PCA write
+    robot->endMotion(motion->first, motion->end);
+    robot->endMotion(motion->second, motion->end);
+    if (robot->pwm != nullptr)
+        robot->pwm->flushPWM();
+
+    if (motion->done != nullptr)
+        motion->done();
+}
+
+void KNWRobot::endMotion(Motor *actuator, char end)
+{
+    if (actuator == nullptr)
+        return;
+    if (end == 's')
+        writeActuator(*actuator, actuator->ZERO, true);
+    else if (end == 'o')
+        pulseActuator(*actuator, 0, true);
+}
+
+void KNWRobot::cancelMotions(Motor *actuator)
+{
+    if (actuator == nullptr)
+        return;
+    for (int i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        TimedMotion &motion = motions[i];
+        if (motion.action != -1 && (motion.first == actuator || motion.second == actuator))
+        {
+            scheduler.cancel(motion.action);
+            motion.action = -1;
+        }
+    }
+}
+
+// Waits like delay(), but keeps the robot's timed actions running
+void KNWRobot::waitFor(int duration)
+{
+    unsigned long start = millis();
+    while (duration > 0 && millis() - start < (unsigned long)duration)
+    {
+        update();
+    }
+}
+
 // ******************************************* //
 // Function to read IR character from sensor.
 // ******************************************* //
 bool KNWRobot::setupIR(int id, int pin)
 {
-    if (checkPin(pin, 'd') && numIR < 4)
+    if (numIR < maxIR && pins.reserve('d', pin, 'r', id))
     {
+        // Start decoding right away so nothing sent before the first scan is lost
+        if (!irSensors[numIR].RECEIVER.begin(pin))
+        {
+            pins.release('d', pin);
+            return false;
+        }
         irSensors[numIR].ID = id;
         irSensors[numIR].PIN = pin;
         irSensors[numIR].TYPE = 'd';
+        irSensors[numIR].COUNT = 0;
+        memset(irSensors[numIR].BUFFER, 0, sizeof(irSensors[numIR].BUFFER));
+        irIndex.add(id, numIR);
         numIR++;
-        digitalPins[pin] = true;
         return true;
     }
     return false;
 }
 
+int KNWRobot::getIRIndex(int id)
+{
+    return irIndex.find(id);
+}
+
+// Moves decoded characters from a sensor's receiver into its scan buffer
+void KNWRobot::collectIR(int index)
+{
+    IRReceiver &receiver = irSensors[index].RECEIVER;
+    if (!receiver.interruptDriven())
+        receiver.poll();
+    while (irSensors[index].COUNT < IR_SCAN_CHARS && receiver.available())
+    {
+        irSensors[index].BUFFER[irSensors[index].COUNT] = receiver.read();
+        irSensors[index].COUNT++;
+    }
+}
+
 int KNWRobot::scanIR(int id)
 {
-    int pin = getPin(id, 'r');
-   if (pin != -1)
+    int index = getIRIndex(id);
+    if (index == -1)
+        return -1; // this is for incorrect ID
+
+    // takes 13 ms per char to broadcast from a beacon
+    // reset the buffer
+    memset(irSensors[index].BUFFER, 0, sizeof(irSensors[index].BUFFER));
+    irSensors[index].COUNT = 0;
+    irSensors[index].RECEIVER.clear();
+    lastIR = index;
+
+    // Decoding happens as edges arrive; just collect characters until the
+    // window closes or the buffer is full
+    unsigned long start = micros();
+    while (micros() - start < IR_SCAN_US && irSensors[index].COUNT < IR_SCAN_CHARS)
     {
-        // takes 13 ms per char to broadcast from a beacon
-        char reading;
-        unsigned char event;
-        // reset the buffer
-        memset(buffer, 0, sizeof(buffer));
-        num_chars = 0;
+        collectIR(index);
+    }
+    return irSensors[index].COUNT;
+}
 
-        unsigned long IRCounter = 0;
+int KNWRobot::scanIRAll(bool firstFrame)
+{
+    for (int i = 0; i < numIR; i++)
+    {
+        memset(irSensors[i].BUFFER, 0, sizeof(irSensors[i].BUFFER));
+        irSensors[i].COUNT = 0;
+        irSensors[i].RECEIVER.clear();
+    }
 
-        // Cycle while we try to watch for a character.
-        while (IRCounter < IR_WAIT)
+    // One pass services every sensor, so they all hear the same frames
+    unsigned long start = micros();
+    unsigned long firstSeen = 0;
+    bool seen = false;
+    while (micros() - start < IR_SCAN_US)
+    {
+        bool allFull = true;
+        for (int i = 0; i < numIR; i++)
         {
-            // Digital level from IR receiver will be inverted
-            if (digitalRead(pin))
-            {
-                if (receiverState)
-                    event = EVENT_FALLING;
-                else
-                    event = EVENT_NONE;
-                receiverState = false;
-            }
-            else
+            collectIR(i);
+            if (irSensors[i].COUNT > 0 && !seen)
             {
-                if (!receiverState)
-                    event = EVENT_RISING;
-                else
-                    event = EVENT_NONE;
-                receiverState = true;
+                seen = true;
+                firstSeen = micros();
             }
-            if (event != EVENT_NONE)
-            {
-                cur_time = micros();
-                ticks = cur_time - prev_time;
-                if (necState == 0)
-                { // Expecting rising edge of leading pulse
-                    if (event == EVENT_RISING)
-                    {
-                        necState = 1;
-                        // digitalWrite(ledPin,HIGH);
-                    }
-                }
-                else if (necState == 1)
-                { // Expecting falling edge of leading pulse
-                    if (event == EVENT_FALLING)
-                    {
-                        if (ticks > 8900L)
-                        {
-                            necState = 2; // Check for leading pulse > 8.9msec
-                        }
-                        else
-                        { // Stray short pulse found, reset NEC state
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0;
-                        }
-                    }
-                }
-                else if (necState == 2)
-                { // Expecting rising edge of first pulse after leading pulse
-                    if (event == EVENT_RISING)
-                    {
-                        if (ticks > 3375L)
-                        { // Check for space after leading pulse > 3.375 msec
-                            IRCharBitMask = 0x80;
-                            IRChar = 0;
-                            necState = 3;
-                        }
-                        else
-                        { // Space too short, reset NEC state to wait for another leading pulse
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0;
-                        }
-                    }
-                }
-                else if (necState == 3)
-                { // Expecting falling edge of data pulse
-                    if (event == EVENT_FALLING)
-                    {
-                        if (ticks < 648)
-                        {
-                            necState = 4; // Check if data pulse width < 648 usec
-                        }
-                        else
-                        { // Width too short, reset NEC state to wait for another leading pulse
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0;
-                        }
-                    }
-                }
-                else if (necState == 4)
-                { // Expecting rising edge of pulse after data pulse
-                    if (event == EVENT_RISING)
-                    {
-                        if (ticks > 1120)
-                        { // Record a '1' bit for space > 1120 usec
-                            IRChar = IRChar | IRCharBitMask;
-                        }
-                        IRCharBitMask = IRCharBitMask >> 1;
-
-                        if (IRCharBitMask == 0)
-                        {                               // Check if eighth bit received and character complete (!!!!!)
-                            buffer[num_chars] = IRChar; // Record complete character received in circular output buffer
-                            num_chars++;
-                            // buffer_in = (buffer_in + 1) & 0x07;
-                            // digitalWrite(ledPin,LOW);
-                            necState = 0; // Reset NEC state to wait for another leading pulse
-                        }
-                        else
-                        {
-                            necState = 3; // Wait for falling edge of data pulse
-                        }
-                    }
-                }
-                prev_time = cur_time;
-            }
-            IRCounter++;
+            if (irSensors[i].COUNT < IR_SCAN_CHARS)
+                allFull = false;
         }
-        // Serial.println(output);
-        return num_chars;
+        if (allFull)
+            break;
+        // Give the other sensors time to finish decoding the same frame
+        if (firstFrame && seen && micros() - firstSeen > IR_FRAME_GRACE_US)
+            break;
     }
-    return -1; // this is for incorrect ID
+
+    int sensorsHit = 0;
+    for (int i = 0; i < numIR; i++)
+    {
+        if (irSensors[i].COUNT > 0)
+            sensorsHit++;
+    }
+    return sensorsHit;
+}
+
+int KNWRobot::countIR(int id)
+{
+    int index = getIRIndex(id);
+    if (index == -1)
+        return -1;
+    return irSensors[index].COUNT;
+}
+
+int KNWRobot::availableIR(int id)
+{
+    return irHandle(id).available();
+}
+
+int KNWRobot::readIR(int id)
+{
+    return irHandle(id).read();
 }
 
 char *KNWRobot::getIR()
 {
-    return buffer;
+    // A robot configured without IR sensors has no buffers at all
+    static char none[1] = {0};
+    return maxIR > 0 ? irSensors[lastIR].BUFFER : none;
+}
+
+char *KNWRobot::getIR(int id)
+{
+    int index = getIRIndex(id);
+    if (index == -1)
+        return nullptr;
+    return irSensors[index].BUFFER;
+}
+
+const char *KNWRobot::getIRMessage(int id)
+{
+    int index = getIRIndex(id);
+    if (index == -1)
+        return nullptr;
+    return irSensors[index].RECEIVER.message();
+}
+
+int KNWRobot::repeatsIR(int id)
+{
+    int index = getIRIndex(id);
+    if (index == -1)
+        return -1;
+    return irSensors[index].RECEIVER.repeats();
+}
+
+long KNWRobot::droppedIR(int id)
+{
+    int index = getIRIndex(id);
+    if (index == -1)
+        return -1;
+    return irSensors[index].RECEIVER.dropped();
 }
 
 void KNWRobot::printVersion()
@@ -916,3 +1384,32 @@ void KNWRobot::printVersion()
     char temp[100] = "ENGR 1357 v1.0";
     printLCD(temp);
 }
+
+// ******************************************* //
+// Component Handles
+// ******************************************* //
+ServoHandle KNWRobot::servoHandle(int id)
+{
+    return ServoHandle(this, getActuator(id, 's'));
+}
+
+MotorHandle KNWRobot::motorHandle(int id)
+{
+    return MotorHandle(this, getActuator(id, 'm'));
+}
+
+PingHandle KNWRobot::pingHandle(int id)
+{
+    return PingHandle(this, getPingSensor(id));
+}
+
+BumpHandle KNWRobot::bumpHandle(int id)
+{
+    return BumpHandle(getPin(id, 'b'));
+}
+
+IRHandle KNWRobot::irHandle(int id)
+{
+    int index = getIRIndex(id);
+    return IRHandle(index == -1 ? nullptr : &irSensors[index].RECEIVER);
+}
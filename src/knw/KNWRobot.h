@@ -13,9 +13,29 @@
 
 #include "Wire.h"
 #include "LiquidCrystal_I2C.h"
+#include "LCDBuffer.h"
+#include "KNWFormat.h"
+#include "KeypadEditor.h"
 #include "Keypad.h"
 #include "Adafruit_PWMServoDriver.h"
 #include "Servo.h"
+#include "NewPing.h"
+#include "IRReceiver.h"
+#include "AnalogSampler.h"
+#include "ConductivityProbe.h"
+#include "KNWScheduler.h"
+#include "IDIndex.h"
+#include "PinMap.h"
+#include "KNWHandles.h"
+#include "PingScheduler.h"
+#include "TemperatureProbe.h"
+
+// Most components of each kind a robot can have
+#define KNW_MAX_PINGS 8
+#define KNW_MAX_BUMPS 8
+#define KNW_MAX_IR 4
+#define KNW_MAX_MOTORS 4
+#define KNW_MAX_SERVOS 16
 
 /**
  * A struct representing a generic component that gets plugged into the arduino.
@@ -41,6 +61,8 @@ struct Component
  * - Trig - the physical pin where Trigger is plugged into
  * - Echo - the physical pin where Echo is plugged into
  * - Type - 'a' for analog, 'd' for digital, and 'p' for PCA board
+ * - Max distance - the farthest distance (in cm) to wait for an echo from
+ * - Sonar - the NewPing instance for this sensor, created once by setupPing()
  */
 struct PingSensor
 {
@@ -48,14 +70,34 @@ struct PingSensor
     int TRIG = 0;
     int ECHO = 0;
     char TYPE = 0;
+    int MAX_DISTANCE = 0;
+    NewPing *SONAR = nullptr;
+};
+/**
+ * A struct representing an IR sensor, with its decoder and the characters of its last scan.
+ * ID - the user-defined ID for the sensor
+ * PIN - The digital pin the sensor's output is plugged into
+ * TYPE - always 'd'
+ * RECEIVER - decodes the sensor's characters in the background
+ * BUFFER - the characters kept by the last scan, plus a terminating NUL
+ * COUNT - how many characters are in BUFFER
+ */
+struct IRSensor
+{
+    int ID = 0;
+    int PIN = 0;
+    char TYPE = 0;
+    IRReceiver RECEIVER;
+    char BUFFER[9] = {0};
+    int COUNT = 0;
 };
 /**
  * A struct representing the component of a Motor / Servo, used to send signals to the PWM.
  * ID - the user-defined ID for the motor
- * PIN - The physical pin where the motor is put into the PWM
- * TYPE - 'a' for analog, 'd' for digital, and 'p' for PCA board
+ * PIN - The physical pin where the motor is plugged in (a digital pin or a PCA board channel)
+ * TYPE - 'd' for a digital pin driven by OBJ, or 'p' for a PCA board channel
  * ZERO - The origin of the servo / motor
- * OBJ - The Servo object instance used by the Arduino
+ * OBJ - The Servo object instance used by the Arduino (only for TYPE 'd')
  */
 struct Motor{
     int ID = 0;
@@ -65,6 +107,26 @@ struct Motor{
     Servo OBJ;
 };
 
+/**
+ * Where a robot keeps its components, and how many of each it has room for.
+ * A KNWConfig (see KNWConfig.h) makes one sized to exactly the components a
+ * sketch declares; without one, the robot allocates room for the most it
+ * supports (KNW_MAX_PINGS and so on).
+ */
+struct KNWStorage
+{
+    PingSensor *pings;
+    int maxPings;
+    Component *bumps;
+    int maxBumps;
+    IRSensor *irs;
+    int maxIR;
+    Motor *motors;
+    int maxMotors;
+    Motor *servos;
+    int maxServos;
+};
+
 /**
  * KNWRobot Library 2.0, brought to you with love by the fabulous KNW TA's.
  *
@@ -156,6 +218,25 @@ public:
         * @endcode
          */
      KNWRobot(long lcdAddress = 0x27);
+
+     /**
+         * Constructor that keeps the components in storage from a KNWConfig, which
+         * has room for exactly the components declared in it, instead of room for
+         * the most the robot supports. Run the config's setup() afterwards to set
+         * the components up.
+         *
+         * @param storage The storage() of a KNWConfig that lives as long as the robot
+         * @param lcdAddress The I2C address of the LCD screen. Default value is 0x27.
+         *
+         * Example usage:
+         *
+         * @code
+         * KNWConfig<KNWPing<1, 24, 25>, KNWServo<2, 0>> config;
+         * KNWRobot *myRobot = new KNWRobot(config.storage());
+         * config.setup(*myRobot);
+         * @endcode
+         */
+     KNWRobot(const KNWStorage &storage, long lcdAddress = 0x27);
      ~KNWRobot();
      void printVersion();
      /**
@@ -167,6 +248,11 @@ public:
          *
          * @returns A boolean array of 16 elements indicating allocation status.
          *
+         * <b>Note</b>: the array is a snapshot taken when this is called, and every
+         * call shares the same one. A pointer you keep won't see pins set up after
+         * the call, until you call this again. To check a single pin, getPinOwner()
+         * is simpler.
+         *
          * Example usage:
          *
          * @code
@@ -189,6 +275,11 @@ public:
          *
          * @returns A boolean array of 54 elements indicating allocation status.
          *
+         * <b>Note</b>: the array is a snapshot taken when this is called, and every
+         * call shares the same one. A pointer you keep won't see pins set up after
+         * the call, until you call this again. To check a single pin, getPinOwner()
+         * is simpler.
+         *
          * Example usage:
          *
          * @code
@@ -212,6 +303,11 @@ public:
          *
          * @returns A boolean array of 16 elements indicating allocation status.
          *
+         * <b>Note</b>: the array is a snapshot taken when this is called, and every
+         * call shares the same one. A pointer you keep won't see pins set up after
+         * the call, until you call this again. To check a single pin, getPinOwner()
+         * is simpler.
+         *
          * @code
          * // Assuming a motor is wired and connected to pwm pin 1
          * myRobot->setupMotor(1, 1);
@@ -222,16 +318,75 @@ public:
          * @endcode
          */
      bool *getPCAPins();
+
+     /**
+         * Finds out what is using a pin. Owners are 'u' for a ping sensor, 'b' bump
+         * sensor, 'r' IR sensor, 's' servo, 'm' DC motor, 'i' inclinometer and 't'
+         * temperature probe, plus the pins the robot keeps for itself: 'x' serial,
+         * 'k' keypad and 'c' conductivity probe.
+         *
+         * @param pin The pin number
+         * @param type 'd' for digital, 'a' for analog or 'p' for the PCA board
+         * @returns The owner of the pin, or 0 if the pin is free or doesn't exist
+         *
+         * Example usage:
+         *
+         * @code
+         * if (myRobot->getPinOwner(24, 'd') == 'u') {
+         *   // A ping sensor is using digital pin 24
+         * }
+         * @endcode
+         */
+     char getPinOwner(int pin, char type);
+
+     /**
+         * Explains why the last setup function that was refused a pin returned
+         * false, in two lines that fit the LCD, such as "Bump 2 pin D25" and
+         * "Ping 1 has it". Every pin a component needs is checked before any is
+         * taken, so a refused component never holds on to some of its pins.
+         *
+         * @param line1 At least 17 characters for the first line
+         * @param line2 At least 17 characters for the second line
+         * @returns true if there was a conflict to explain, false otherwise (and
+         * both lines are left empty)
+         *
+         * Example usage:
+         *
+         * @code
+         * char line1[17], line2[17];
+         * if (!myRobot->setupBump(2, 25) && myRobot->getPinConflict(line1, line2)) {
+         *   Serial.println(line1);
+         *   Serial.println(line2);
+         * }
+         * @endcode
+         */
+     bool getPinConflict(char *line1, char *line2);
+
+     /**
+         * Same as getPinConflict(), but shows the explanation on the LCD screen.
+         *
+         * @returns true if there was a conflict to show, false otherwise (and the
+         * LCD is left alone)
+         *
+         * Example usage:
+         *
+         * @code
+         * if (!myRobot->setupPing(1, 24, 25)) {
+         *   myRobot->printPinConflict();
+         * }
+         * @endcode
+         */
+     bool printPinConflict();
      /**
       * Accessor function to get the pin of the Trigger for a Ping Sensor.
       * @param id : The user-defined id of the ping sensor desired
-      * @returns the pin which the Trigger is plugged into
+      * @returns the pin which the Trigger is plugged into, or -1 for an unknown id
       */
      int getTrig(int id);
      /**
       * Accessor function to get the pin of the Echo for a Ping Sensor.
       * @param id : The user-defined id of the ping sensor desired
-      * @returns the pin which the Echo is plugged into
+      * @returns the pin which the Echo is plugged into, or -1 for an unknown id
       */
      int getEcho(int id);
 
@@ -249,22 +404,37 @@ public:
          * @param id A unique identifier that you specify. You will use this identifier
          * when running getPing(int), so it's recommended you assign it to a variable.
          * It is also recommended you make it equal to the pin number it is assigned to.
-         * @param pin The digital pin that the ping sensor is connected to.
+         * @param trigger The digital pin that the ping sensor's trigger is connected to.
+         * @param echo The digital pin that the ping sensor's echo is connected to.
+         * @param maxDistance The farthest distance <b>in centimeters</b> to measure. Anything
+         * farther away reads as 0. Smaller values make getPing() return sooner when nothing
+         * is in front of the sensor. Default value is 200.
          * @return true If the ping sensor was successfully assigned to the pin
          * @return false If the ping sensor was not assigned to the pin
          *
          * Example usage:
          *
          * @code
-         * // Assuming a ping sensor is wired and connected to digital pin 2
+         * // Assuming a ping sensor is wired with its trigger on digital pin 2
+         * // and its echo on digital pin 3
          * int pingSensorId = 1;
-         * bool success = myRobot->setupPing(pingSensorId, 2);
+         * bool success = myRobot->setupPing(pingSensorId, 2, 3);
          * if (success) {
          *   // Now ready to use the ping sensor with pingSensorId
          * }
          * @endcode
          */
-     bool setupPing(int id, int trigger, int echo);
+     bool setupPing(int id, int trigger, int echo, int maxDistance = 200);
+
+     /**
+         * Changes the farthest distance a ping sensor measures (see setupPing()).
+         *
+         * @param id The integer identifier specified during the setupPing() call
+         * @param maxDistance The new maximum distance <b>in centimeters</b>.
+         * @return true If the maximum distance was changed
+         * @return false If the id is invalid or the distance is not positive
+         */
+     bool setPingMaxDistance(int id, int maxDistance);
 
      /**
          * Triggers a ping sensor to sense how far it is away from an object in front of it.
@@ -283,6 +453,10 @@ public:
          * object in front of it to be. If the ping sensor has not been setup, this will
          * return -1.
          *
+         * <b>Note</b>: the distance is cut down to a whole centimeter, as it always
+         * has been. Once setPingTemperature() has been called, it is rounded to the
+         * nearest centimeter instead.
+         *
          * Example usage:
          *
          * @code
@@ -293,6 +467,147 @@ public:
          */
      long getPing(int id);
 
+     /**
+         * Same as getPing(), but <b>in millimeters</b>, for when a centimeter isn't
+         * precise enough.
+         *
+         * @param id The integer identifier specified during the setupPing() call
+         * @return long The distance in mm, 0 if nothing was in range, or -1 if the
+         * ping sensor has not been setup.
+         */
+     long getPingMM(int id);
+
+     /**
+         * Tells the ping sensors how warm the air is. Sound travels faster in warm
+         * air (about 0.6 m/s more per degree), so without this, distances measured
+         * in a hot room read short and in a cold one read long. Until this is called,
+         * the speed of sound of the NewPing library is used.
+         *
+         * @param tenthsC The air temperature in tenths of a degree Celsius, e.g. 215
+         * for 21.5 C. Must be between -400 and 600.
+         * @return true If the temperature was set
+         * @return false If the temperature is out of range
+         *
+         * Example usage:
+         *
+         * @code
+         * // The course is outside on a hot day
+         * myRobot->setPingTemperature(350);
+         * long distanceInMm = myRobot->getPingMM(pingSensorId);
+         * @endcode
+         */
+     bool setPingTemperature(int tenthsC);
+
+     /**
+         * Starts pinging every ping sensor that has been set up, one after another,
+         * in the background. Only one sensor pings at a time, one every intervalMs,
+         * so with 3 sensors each one is measured every 3 * intervalMs. Pings are
+         * started from update(), so call it often from your loop(), and read the
+         * results with getPingCached() instead of waiting for getPing().
+         *
+         * <b>Note:</b> On the arduino this uses timer 2, so analogWrite() on pins 9
+         * and 10 and tone() don't work while pings are running. Sensors set up
+         * afterwards are only pinged once you call startPings() again.
+         *
+         * @param intervalMs Milliseconds between two pings. Pinging sooner than
+         * ~29ms can pick up the last sensor's echo. Default value is 33.
+         * @return true If the pings were started
+         * @return false If no ping sensor has been set up
+         *
+         * Example usage:
+         *
+         * @code
+         * myRobot->setupPing(1, 2, 3);
+         * myRobot->setupPing(2, 4, 5);
+         * myRobot->startPings();
+         *
+         * void loop() {
+         *   myRobot->update();
+         *   if (myRobot->getPingCached(1) > 0 && myRobot->getPingCached(1) < 30) {
+         *     // Wall ahead
+         *   }
+         * }
+         * @endcode
+         */
+     bool startPings(int intervalMs = PING_INTERVAL_MS);
+
+     // Stops the background pings started by startPings()
+     void stopPings();
+
+     /**
+         * Returns the latest distance measured by the background pings (see
+         * startPings()) without waiting.
+         *
+         * @param id The integer identifier specified during the setupPing() call
+         * @return long The distance <b>in centimeters</b>, 0 if nothing was in range,
+         * or -1 if the id is invalid or the sensor hasn't been measured yet.
+         */
+     long getPingCached(int id);
+
+     // Same as getPingCached(), in millimeters
+     long getPingCachedMM(int id);
+
+     /**
+         * Returns when the distance from getPingCached() was measured.
+         *
+         * @param id The integer identifier specified during the setupPing() call
+         * @return unsigned long The millis() at which the echo came back, or 0 if
+         * there is no measurement yet. millis() - getPingTime(id) is its age.
+         */
+     unsigned long getPingTime(int id);
+
+     /**
+         * Chooses how the background pings of a sensor (see startPings()) are smoothed
+         * for getPingFiltered(). Every sensor starts with type 'n'.
+         *
+         * @param id The integer identifier specified during the setupPing() call
+         * @param type 'n' for no filtering (the latest reading), 'm' for the median,
+         * 't' for the trimmed mean (average without the highest and lowest readings)
+         * or 'e' for exponential smoothing
+         * @param window How many of the latest readings to look at [1 - 9]. Larger
+         * windows are steadier but slower to follow a change. Default value is 5.
+         * @return true If the filter was set
+         * @return false If the id, type or window is invalid
+         *
+         * Example usage:
+         *
+         * @code
+         * // Median of the last 5 pings: one bad echo doesn't move the reading
+         * myRobot->setPingFilter(pingSensorId, 'm');
+         * myRobot->startPings();
+         * @endcode
+         */
+     bool setPingFilter(int id, char type, int window = PING_WINDOW_DEFAULT);
+
+     /**
+         * Returns the smoothed distance of a sensor from its latest background pings
+         * (see setPingFilter()), without waiting. Lost echoes are left out, so they
+         * don't pull the distance down to 0.
+         *
+         * @param id The integer identifier specified during the setupPing() call
+         * @return long The distance <b>in centimeters</b>, 0 if none of the latest
+         * pings had an echo, or -1 if the id is invalid or there are no readings yet.
+         */
+     long getPingFiltered(int id);
+
+     /**
+         * Returns how many of the pings getPingFiltered() looked at had an echo. When
+         * it is low compared to the window, the filtered distance is less certain.
+         *
+         * @param id The integer identifier specified during the setupPing() call
+         * @return int The number of valid readings in the window, or -1 if the id is invalid.
+         *
+         * Example usage:
+         *
+         * @code
+         * // Only trust the distance if at least 3 of the last 5 pings came back
+         * if (myRobot->getPingValid(pingSensorId) >= 3) {
+         *   long distance = myRobot->getPingFiltered(pingSensorId);
+         * }
+         * @endcode
+         */
+     int getPingValid(int id);
+
      /**
          * Sets up and assigns a bump sensor to run on the specified digital pin.
          * A <a href="https://www.instructables.com/id/Cheap-Robot-Bump-Sensors-for-Arduino/">bump sensor</a>
@@ -405,6 +720,40 @@ public:
          */
      int getIncline();
 
+     /**
+         * Starts reading the inclinometer, temperature probe and conductivity probe
+         * in the background, so getIncline(), getTemp() and getConductivity() no longer
+         * wait about 0.1 milliseconds for the analog pin on every reading. The arduino's
+         * converter keeps cycling through those pins on its own, and each reading just
+         * picks up the latest value. Sensors set up afterwards are added automatically.
+         *
+         * <b>Note:</b> While this is running, don't call analogRead() yourself; it would
+         * fight over the converter with the background readings.
+         *
+         * <b>Note:</b> By default the pins are read from update(), so call it often. With
+         * KNW_ANALOG_INTERRUPT; at the top of your sketch (outside any function), the
+         * converter's interrupt reads them instead, with no help from update(). Leave
+         * it out if another library in your sketch defines that interrupt (ADC_vect).
+         *
+         * @param oversample How many readings of the inclinometer and temperature probe
+         * are averaged into each value: 1, 2, 4, 8, 16, 32 or 64. More is steadier but
+         * slower to follow changes. Default value is 4.
+         * @return true If background reading started
+         * @return false If no analog sensor is set up or oversample is invalid
+         *
+         * Example usage:
+         *
+         * @code
+         * myRobot->setupIncline(0);
+         * myRobot->startAnalogSampling();
+         * int inclineReading = myRobot->getIncline(); // Returns right away
+         * @endcode
+         */
+     bool startAnalogSampling(int oversample = 4);
+
+     // Stops the background reading started by startAnalogSampling()
+     void stopAnalogSampling();
+
      /**
          * Provides a reading of the conductivity probe.
          *
@@ -424,7 +773,8 @@ public:
          * to calibrate your conductivity probe much in the same way you calibrate your
          * inclinometer. Be sure to read getIncline() for more details, as well as Canvas.
          *
-         * @return int A value between [0 - 1023] telling you the raw analog pin reading.
+         * @return int A value between [0 - 1023] telling you the raw analog pin reading,
+         * or -1 if the measurement could not be started or did not finish in time.
          *
          * Example code:
          *
@@ -435,9 +785,60 @@ public:
          * // Note that this will print the raw value, not the conductivity of the sand.
          * myRobot->printLCD(conductivityReading);
          * @endcode
+         *
+         * <b>Note</b>: this blocks, waiting 3 seconds for the probe to settle (half a
+         * second more at most before giving up). To keep your robot moving while it
+         * does, use startConductivity() instead.
          */
      int getConductivity();
 
+     /**
+         * Starts a conductivity measurement in the background and returns right away.
+         * The probe is driven from update() and conductivityReady() while your loop()
+         * keeps running, so call one of them at least every millisecond until the
+         * reading is done (or add KNW_CONDUCTIVITY_TIMER; at the top of your sketch
+         * to drive it from a timer interrupt, see ConductivityProbe.h). Then get it
+         * from conductivityResult(). With the default arguments, the reading is the
+         * same as the one getConductivity() gives you.
+         *
+         * @param durationMs How long to let the probe settle, in milliseconds.
+         * @param frequency How many times per second the probe's polarity is flipped [4 - 250].
+         * @return true If the measurement was started
+         * @return false If the measurement could not be started
+         *
+         * Example code:
+         *
+         * @code
+         * myRobot->startConductivity();
+         *
+         * // Later, in loop()
+         * if (myRobot->conductivityReady()) {
+         *   myRobot->printLCD(myRobot->conductivityResult());
+         *   myRobot->startConductivity(); // Start the next reading
+         * }
+         * // Keep driving
+         * @endcode
+         */
+     bool startConductivity(unsigned long durationMs = CONDUCTIVITY_DURATION_MS,
+                            int frequency = CONDUCTIVITY_FREQUENCY);
+
+     /**
+         * Tells you whether the measurement started by startConductivity() has
+         * finished. Call this often; it returns immediately.
+         *
+         * @return true If conductivityResult() has a fresh reading
+         * @return false If the measurement is still running (or was never started)
+         */
+     bool conductivityReady();
+
+     /**
+         * The reading from the most recently finished conductivity measurement, in the
+         * same [0 - 1023] range as getConductivity().
+         *
+         * @return int The raw reading, or -1 if no measurement has finished yet.
+         */
+     int conductivityResult();
+
      /**
          * Sets up and assigns your temperature probe to run on the specified analog pin.
          * A temperature probe is a sensor that, when built and calibrated properly, can
@@ -470,7 +871,13 @@ public:
          * such, this sensor requires calibration like your inclinometer and your conductivity
          * probe. Refer to getIncline() for more information around calibration.
          *
-         * @return int A value between [0 - 1023] telling you the raw analog pin reading.
+         * The probe is read in the background from update() (and from this function),
+         * and this returns the average of its last 16 readings (taken over about an
+         * eighth of a second), so it doesn't wait for the analog pin and is steadier
+         * than a single reading. Call update() often from your loop() to keep it current.
+         *
+         * @return int A value between [0 - 1023] telling you the raw analog pin reading,
+         * or -1 if setupTemp() hasn't been run.
          *
          * Example code:
          *
@@ -484,6 +891,47 @@ public:
          */
      int getTemp();
 
+     /**
+         * Calibrates the temperature probe with two readings of getTemp() taken at known
+         * temperatures, so getTempTenthsC() can tell you the actual temperature. The
+         * temperature is assumed to change in a straight line between (and beyond) the
+         * two points, so pick them at either end of the range you care about.
+         *
+         * Once calibrated, the ping sensors also use this temperature for the speed of
+         * sound (see setPingTemperature()).
+         *
+         * @param raw1 getTemp() at the first temperature
+         * @param tenthsC1 The first temperature, in tenths of a degree Celsius
+         * @param raw2 getTemp() at the second temperature
+         * @param tenthsC2 The second temperature, in tenths of a degree Celsius
+         * @return true If the calibration was accepted
+         * @return false If the readings are out of range, equal, or too close together
+         * for the temperatures (more than 6.4 degrees per step)
+         *
+         * Example usage:
+         *
+         * @code
+         * // The probe read 310 in ice water and 655 in boiling water
+         * myRobot->calibrateTemp(310, 0, 655, 1000);
+         * @endcode
+         */
+     bool calibrateTemp(int raw1, int tenthsC1, int raw2, int tenthsC2);
+
+     /**
+         * Provides the temperature of the probe after calibrateTemp().
+         *
+         * @return int The temperature in tenths of a degree Celsius (e.g. 215 for 21.5 C),
+         * or -32768 if the probe hasn't been set up or calibrated.
+         *
+         * Example code:
+         *
+         * @code
+         * int temperature = myRobot->getTempTenthsC();
+         * myRobot->printLCD(temperature / 10);
+         * @endcode
+         */
+     int getTempTenthsC();
+
      /**
          * Clears out the LCD, and gets input from the number pad.
          *
@@ -492,7 +940,9 @@ public:
          * can enter up to 15 digits, followed by the '#' sign, and this function
          * will return the entered value to your code.
          *
-         * The buttons you pressed will appear on the LCD. There are a few special buttons:
+         * The buttons you pressed will appear on the LCD. While you type, update() keeps
+         * running, so anything started with the Async functions, runAfter() or
+         * startPings() keeps going. There are a few special buttons:
          *
          * <ul>
          *   <li>`*` = backspace</li>
@@ -503,6 +953,10 @@ public:
          *   </li>
          * </ul>
          *
+         * At most 16 characters fit on the row; keys pressed after that are ignored
+         * until you press `*` or `#`. (Older versions entered the input on their own
+         * when a 17th key was pressed.)
+         *
          * @return int The numbers / characters you input.
          *
          * Example code
@@ -553,6 +1007,67 @@ public:
          */
      int getKeypadInput(int row);
 
+     /**
+         * Starts getting input from the number pad without waiting for it.
+         *
+         * Works like getKeypadInput(int), but returns right away: keys are picked up
+         * and shown on the LCD by update(), so your loop can keep driving the robot
+         * while you type. Check keypadInputState() to find out when the input is
+         * finished, and keypadInputResult() for what was typed.
+         *
+         * The buttons are the same as getKeypadInput(), except `*` on an empty line
+         * cancels the input.
+         *
+         * @param row Either 0 or 1, the row to show the input on, from the first column
+         * @param mode 'n' for digits only (the default), 'l' for one letter from A to D
+         * (the input finishes as soon as it is pressed), or 'a' for both, like
+         * getKeypadInput()
+         * @param maxLength The most characters that can be typed [1 - 16]; keys
+         * pressed after that are ignored
+         * @returns true if the input started, false if mode or maxLength is invalid
+         *
+         * Example code:
+         *
+         * @code
+         * myRobot->printLCD((char *)"Angle:");
+         * myRobot->startKeypadInput(1, 'n', 3);
+         *
+         * void loop() {
+         *   myRobot->update();
+         *   if (myRobot->keypadInputState() == KEYPAD_DONE) {
+         *     myRobot->pca180Servo(servoID, myRobot->keypadInputResult());
+         *     myRobot->startKeypadInput(1, 'n', 3);
+         *   }
+         *   // Keep driving while the angle is typed
+         * }
+         * @endcode
+         */
+     bool startKeypadInput(int row = 0, char mode = 'n', int maxLength = 16);
+
+     /**
+         * Finds out how the input started by startKeypadInput() is going.
+         *
+         * @returns KEYPAD_EDITING while it is being typed, KEYPAD_DONE once `#` (or a
+         * letter, in mode 'l') is pressed, KEYPAD_CANCELLED if it was cancelled, or
+         * KEYPAD_IDLE if no input was started
+         */
+     char keypadInputState();
+
+     /**
+         * The input typed after startKeypadInput(), once keypadInputState() is
+         * KEYPAD_DONE.
+         *
+         * @returns The number typed, or the letter if one was typed (as in
+         * getKeypadInput()), or -1 if the input isn't done
+         */
+     int keypadInputResult();
+
+     /**
+         * Cancels the input started by startKeypadInput(); keypadInputState() becomes
+         * KEYPAD_CANCELLED.
+         */
+     void stopKeypadInput();
+
      /**
          * Clears the LCD of all content.
          *
@@ -674,9 +1189,32 @@ public:
 
      /**
          * Use this to print the double value input with n digits after the decimal point (n being decimalPlaces)
+         *
+         * The last digit is rounded, and negative values keep their sign, even
+         * between -1 and 0. decimalPlaces can be at most 6.
          */
      void printLCD(double input, short decimalPlaces);
 
+     /**
+         * Prints a double with n digits after the decimal point, right-aligned in a
+         * field of width characters, so numbers printed in the same spot line up and
+         * a shorter number covers a longer one printed before it.
+         *
+         * @param input The number to print
+         * @param decimalPlaces Digits after the decimal point [0 - 6]
+         * @param width Characters the number takes up [0 - 16]; it is padded with
+         * spaces on the left, and never cut if it is longer
+         *
+         * Example code:
+         *
+         * @code
+         * myRobot->moveCursor(0, 0);
+         * myRobot->printLCD((char *)"Volts");
+         * myRobot->printLCD(voltage, 2, 11); // "Volts       4.75"
+         * @endcode
+         */
+     void printLCD(double input, short decimalPlaces, short width);
+
      /**
          * Calls printLCD(double, int) with 3 digits after decimal
          */
@@ -702,6 +1240,51 @@ public:
          */
      void printLCD(char input);
 
+     /**
+         * Turns buffering of the LCD on or off.
+         *
+         * The robot keeps a copy of the screen and only sends the characters that
+         * changed, so printing the same text again costs nothing. Without buffering
+         * (the default) every LCD function sends its changes right away. With it,
+         * the LCD functions return right away and the changes are sent in the
+         * background: each update() sends a few characters, so no loop ever waits
+         * on the LCD for long, and flushLCD() sends everything at once. You can clear
+         * the screen and print it again from scratch every loop and only what
+         * actually changed gets sent.
+         *
+         * @param buffered true to buffer the LCD, false to send every change right away.
+         * Turning buffering off sends anything still waiting.
+         *
+         * Example code:
+         *
+         * @code
+         * myRobot->bufferLCD(true);
+         *
+         * void loop() {
+         *   myRobot->clearLCD();
+         *   myRobot->printLCD("Dist: ");
+         *   myRobot->printLCD(myRobot->getPing(pingId));
+         *   myRobot->update(); // sends some of the digits that changed
+         * }
+         * @endcode
+         */
+     void bufferLCD(bool buffered);
+
+     /**
+         * Sends what changed on the LCD since it was last sent. update() calls this
+         * when the LCD is buffered.
+         *
+         * @returns How many characters and cursor moves were sent to the LCD
+         */
+     int flushLCD();
+
+     /**
+         * Finds out whether a buffered LCD still has changes to send.
+         *
+         * @returns true while something printed isn't on the screen yet
+         */
+     bool lcdPending();
+
      /**
          * Sets up and assigns a servo motor to run on the specified pin on the PCA board.
          * There are two types of servo: a 180 degree servo and a continuous rotation servo
@@ -731,8 +1314,11 @@ public:
          * @param id A unique identifier that you specify. You will use this identifier
          * when running the various pca servo functions, so it's recommended you assign it to a variable.
          * It is also recommended you make it equal to the pin number it is assigned to.
-         * @param pin The pin on the PCA board that servo is connected to.
+         * @param pin The pin that servo is connected to.
          * @param zero The "zero value" for a servo to use no power. Do not modify this if you do not know what you are doing. Default value is 94.
+         * @param type Where the servo is connected: 'd' (the default) for a digital pin on the
+         * arduino, or 'p' for a channel (0 - 15) on the PCA board. On the PCA board the pulses
+         * are made by the board itself, which takes load off the arduino.
          * @return true If the servo was successfully assigned to the pin
          * @return false If the servo was not assigned to the pin
          *
@@ -741,13 +1327,13 @@ public:
          * @code
          * // Assuming a servo is wired and connected to PCA board pin 2
          * int servoId = 1;
-         * bool success = myRobot->setupServo(servoId, 2);
+         * bool success = myRobot->setupServo(servoId, 2, 94, 'p');
          * if (success) {
          *   // Now ready to use the servo with servoId
          * }
          * @endcode
          */
-     bool setupServo(int id, int pin, int zero = 94);
+     bool setupServo(int id, int pin, int zero = 94, char type = 'd');
 
      /**
          * Sets up and assigns a DC motor to run on the specified pin on the PCA board.
@@ -773,7 +1359,10 @@ public:
          * @param id A unique identifier that you specify. You will use this identifier
          * when running the various pca motor functions, so it's recommended you assign it to a variable.
          * It is also recommended you make it equal to the pin number it is assigned to.
-         * @param pin The pin on the PCA board that motor is connected to.
+         * @param pin The pin that motor is connected to.
+         * @param zero The "zero value" for the motor to stop. Default value is 90.
+         * @param type Where the motor is connected: 'd' (the default) for a digital pin on the
+         * arduino, or 'p' for a channel (0 - 15) on the PCA board.
          * @return true If the motor was successfully assigned to the pin
          * @return false If the motor was not assigned to the pin
          *
@@ -782,13 +1371,13 @@ public:
          * @code
          * // Assuming a motor is wired and connected to PCA board pin 3
          * int motorId = 3;
-         * bool success = myRobot->setupMotor(motorId, 3);
+         * bool success = myRobot->setupMotor(motorId, 3, 90, 'p');
          * if (success) {
          *   // Now ready to use the motor with motorId
          * }
          * @endcode
          */
-     bool setupMotor(int id, int pin, int zero = 90);
+     bool setupMotor(int id, int pin, int zero = 90, char type = 'd');
 
      /**
          * Stops a motor or servo with the provided identifier.
@@ -1100,6 +1689,142 @@ public:
          int speed2,
          int duration);
 
+     /**
+         * Runs the robot's timed actions. Call this as often as you can from your
+         * loop() (and from any loop where you wait for something) when you use the
+         * Async motion functions, runAfter(), runEvery() or startPings(), to keep
+         * getTemp() current, and to send a buffered LCD a few characters at a time
+         * (see bufferLCD()). Timed actions only finish, and pings and temperature
+         * readings only happen, when update() is called, so the more often you call
+         * it, the more accurate their timing is.
+         *
+         * The blocking *Time() functions call this while they wait, so actions you
+         * started earlier keep running during them.
+         *
+         * Example code:
+         *
+         * @code
+         * void loop() {
+         *   myRobot->update();
+         *   // Check sensors, keep driving
+         * }
+         * @endcode
+         */
+     void update();
+
+     /**
+         * Same as pca180ServoTime(), but returns right away instead of waiting. The
+         * servo moves now, and the action finishes once the duration has passed (see
+         * update()).
+         *
+         * @param id The identifier that was passed as the first argument into setupServo()
+         * @param angle The angle to move the servo to.
+         * @param duration The duration <b><i>in milliseconds</i></b> of the action.
+         * @param done An optional function to call when the action finishes.
+         * @return int A number for this action to pass to actionDone() or cancelAction(),
+         * or -1 if the id is invalid or too many actions are running.
+         */
+     int pca180ServoTimeAsync(int id, int angle, int duration, void (*done)() = nullptr);
+
+     /**
+         * Same as pcaContServoTime(), but returns right away instead of waiting. The
+         * servo stops once the duration has passed (see update()).
+         *
+         * @param id The identifier that was passed as the first argument into setupServo()
+         * @param speed The speed between [-90, 90] to run the servo at.
+         * @param duration The duration <b><i>in milliseconds</i></b> to run the servo for.
+         * @param done An optional function to call when the servo stops.
+         * @return int A number for this action to pass to actionDone() or cancelAction(),
+         * or -1 if the id is invalid or too many actions are running.
+         */
+     int pcaContServoTimeAsync(int id, int speed, int duration, void (*done)() = nullptr);
+
+     /**
+         * Same as pcaDCMotorTime(), but returns right away instead of waiting. The
+         * motor stops once the duration has passed (see update()).
+         *
+         * @param id The identifier that was passed as the first argument into setupMotor()
+         * @param speed The speed between [0 - 180] to set the motor to.
+         * @param duration The duration <b><i>in milliseconds</i></b> to run the motor for.
+         * @param done An optional function to call when the motor stops.
+         * @return int A number for this action to pass to actionDone() or cancelAction(),
+         * or -1 if the id is invalid or too many actions are running.
+         *
+         * Example code:
+         *
+         * @code
+         * // Suppose you have already run setupMotor()
+         * int action = myRobot->pcaDCMotorTimeAsync(motorId, 45, 5000);
+         * while (!myRobot->actionDone(action)) {
+         *   myRobot->update();
+         *   // Read sensors while the motor runs
+         * }
+         * @endcode
+         */
+     int pcaDCMotorTimeAsync(int id, int speed, int duration, void (*done)() = nullptr);
+
+     /**
+         * Same as pcaDC2MotorsTime(), but returns right away instead of waiting. Both
+         * motors stop together once the duration has passed (see update()).
+         *
+         * @param id1 The identifier of the first motor you want to move.
+         * @param speed1 The speed between [0 - 180] to set the first motor to.
+         * @param id2 The identifier of the second motor you want to move.
+         * @param speed2 The speed between [0 - 180] to set the second motor to.
+         * @param duration The duration <b><i>in milliseconds</i></b> to run the motors for.
+         * @param done An optional function to call when the motors stop.
+         * @return int A number for this action to pass to actionDone() or cancelAction(),
+         * or -1 if an id is invalid or too many actions are running.
+         */
+     int pcaDC2MotorsTimeAsync(
+         int id1,
+         int speed1,
+         int id2,
+         int speed2,
+         int duration,
+         void (*done)() = nullptr);
+
+     /**
+         * Runs a function of yours once, after the given number of milliseconds
+         * (see update()).
+         *
+         * @param delayMs How long to wait, in milliseconds.
+         * @param task The function to run.
+         * @return int A number for this action to pass to actionDone() or cancelAction(),
+         * or -1 if too many actions are running.
+         */
+     int runAfter(unsigned long delayMs, void (*task)());
+
+     /**
+         * Runs a function of yours over and over, every given number of milliseconds
+         * (see update()), until you call cancelAction().
+         *
+         * @param periodMs Time between runs, in milliseconds.
+         * @param task The function to run.
+         * @return int A number for this action to pass to cancelAction(), or -1 if too
+         * many actions are running.
+         */
+     int runEvery(unsigned long periodMs, void (*task)());
+
+     /**
+         * Tells you whether an action has finished.
+         *
+         * @param action The number returned when the action was started.
+         * @return true If the action has finished (or was cancelled, or the number is invalid)
+         * @return false If the action is still running
+         */
+     bool actionDone(int action);
+
+     /**
+         * Cancels an action before it finishes. Its done function is not called, and a
+         * motor or servo it started keeps going until you tell it otherwise.
+         *
+         * @param action The number returned when the action was started.
+         * @return true If the action was cancelled
+         * @return false If the action had already finished
+         */
+     bool cancelAction(int action);
+
      /**
          * Sets up and assigns an IR navigation sensor to run on the specified digital pin.
          * An IR navigation sensor is used to detect the values being emitted by the various
@@ -1107,7 +1832,15 @@ public:
          * on how to properly wire and connect your IR sensor.
          *
          * <b>Note:</b> The arduino supports connecting up to 4 IR sensors
-         * at one time.
+         * at one time. Each sensor is decoded separately, so they can all
+         * listen at the same time (see scanIRAll()).
+         *
+         * <b>Note:</b> Pins 2, 3, 18, 19, 20 and 21 are read with an interrupt.
+         * Pins 10-13, 50-53 and A8-A15 can be too, but only if the sketch adds
+         * KNW_IR_PIN_CHANGE(0) (pins 10-13 and 50-53) or KNW_IR_PIN_CHANGE(2)
+         * (A8-A15) at the top. Those interrupts can't be shared, so leave them
+         * out when the sketch also uses SoftwareSerial. Without an interrupt,
+         * the sensor is only read from scanIR(), scanIRAll() and availableIR().
          *
          * @param id A unique identifier that you specify. You will use this identifier
          * when running scanIR(), so it's recommended you assign it to a variable.
@@ -1137,6 +1870,10 @@ public:
          * The values that it reads are stored in an internal character buffer, which you
          * can access using getIR() after running this function.
          *
+         * scanIR() waits for up to 0.4 seconds (or until 8 characters arrive) and your
+         * robot can't do anything else in the meantime. If you need to keep driving
+         * while you listen for a beacon, use availableIR() and readIR() instead.
+         *
          * <b>Note</b>: the function will return -1 if the pin passed for scanIR() is invalid
          * 
          * <b>Note</b>: every time you want to get fresh values from getIR(), you have to
@@ -1189,6 +1926,126 @@ public:
          */
      char *getIR();
 
+     /**
+         * Same as getIR(), but for a specific IR sensor. Use this after scanIRAll()
+         * to see what each sensor received.
+         *
+         * @param id The identifier that was provided as the first argument to setupIR().
+         * @return char* The characters that sensor read during the most recent
+         * scanIR() or scanIRAll(), or nullptr if the id is invalid.
+         */
+     char *getIR(int id);
+
+     /**
+         * Listens on every IR sensor at the same time, instead of one after another.
+         * Each sensor's characters can then be read with getIR(id), and
+         * countIR(id) tells you how many each one got.
+         *
+         * With firstFrame set to true, this returns as soon as the first beacon
+         * character has arrived (about 13 ms into a transmission) instead of
+         * listening for the full 0.4 seconds. Sensors that could see the beacon
+         * all receive that same character, so comparing which sensors got it tells
+         * you which direction the beacon is in.
+         *
+         * @param firstFrame true to stop after the first character, false to listen
+         * for the full scan window.
+         * @return int The number of sensors that received at least one character.
+         *
+         * Example code:
+         *
+         * @code
+         * // Assuming IR sensors with IDs LEFT_IR, FRONT_IR and RIGHT_IR are set up
+         * if (myRobot->scanIRAll(true) > 0) {
+         *   bool left = myRobot->countIR(LEFT_IR) > 0;
+         *   bool right = myRobot->countIR(RIGHT_IR) > 0;
+         *   if (left && !right) {
+         *     // Beacon is to the left
+         *   }
+         * }
+         * @endcode
+         */
+     int scanIRAll(bool firstFrame = false);
+
+     /**
+         * How many characters the given IR sensor read during the most recent
+         * scanIR() or scanIRAll().
+         *
+         * @param id The identifier that was provided as the first argument to setupIR().
+         * @return int The number of characters, or -1 if the id is invalid.
+         */
+     int countIR(int id);
+
+     /**
+         * Tells you how many beacon characters the IR sensor has received that you
+         * have not read yet. Unlike scanIR(), this returns immediately: every IR
+         * sensor is listened to in the background from the moment setupIR() is
+         * called, so you can call this from your loop() while your robot keeps moving.
+         *
+         * @param id The identifier that was provided as the first argument to setupIR().
+         * @return int The number of characters waiting to be read, or -1 if the id is invalid.
+         *
+         * Example code:
+         *
+         * @code
+         * // Assuming you have already run the code in setupIR()
+         * while (myRobot->availableIR(IRSensorId) > 0) {
+         *   char beacon = myRobot->readIR(IRSensorId);
+         *   myRobot->printLCD(beacon);
+         * }
+         * // Keep driving
+         * @endcode
+         */
+     int availableIR(int id);
+
+     /**
+         * Gives you the next beacon character received by the IR sensor. Returns
+         * immediately; see availableIR() for details.
+         *
+         * @param id The identifier that was provided as the first argument to setupIR().
+         * @return int The character that was received, or -1 if there is none waiting
+         * (or the id is invalid).
+         */
+     int readIR(int id);
+
+     /**
+         * Gives you the last complete message the IR sensor heard from a beacon,
+         * such as "KNW". Beacons send their message over and over; repeats of the
+         * same message are counted by repeatsIR() rather than showing up again.
+         * Like availableIR(), this returns immediately.
+         *
+         * @param id The identifier that was provided as the first argument to setupIR().
+         * @return const char* The message ("" if none has been heard yet), or nullptr
+         * if the id is invalid.
+         *
+         * Example code:
+         *
+         * @code
+         * // Assuming you have already run the code in setupIR()
+         * if (strcmp(myRobot->getIRMessage(IRSensorId), "KNW") == 0) {
+         *   // Found the beacon we were looking for
+         * }
+         * @endcode
+         */
+     const char *getIRMessage(int id);
+
+     /**
+         * How many times in a row the IR sensor has heard the message returned by
+         * getIRMessage().
+         *
+         * @param id The identifier that was provided as the first argument to setupIR().
+         * @return int The repeat count, or -1 if the id is invalid.
+         */
+     int repeatsIR(int id);
+
+     /**
+         * How many beacon messages the IR sensor has lost characters from because
+         * they were not read with readIR() quickly enough.
+         *
+         * @param id The identifier that was provided as the first argument to setupIR().
+         * @return long The number of damaged messages, or -1 if the id is invalid.
+         */
+     long droppedIR(int id);
+
      /** 
         *   Reset functions to redo setup of keypad and LCD; these may
         *   be called if the LCD was not activated on KNWRobot instantiation
@@ -1197,18 +2054,65 @@ public:
 
      void resetLCD(long lcdPin);
 
+     /**
+         * Handles to components that have been set up. A handle finds the component
+         * once, so calling its functions skips the id lookup that every other function
+         * does, which helps in loops that run very often. Get them once, right after
+         * the setup function, and keep them. A handle for an id that wasn't set up is
+         * not valid() and does nothing.
+         *
+         * @param id The identifier the component was set up with
+         *
+         * Example usage:
+         *
+         * @code
+         * myRobot->setupMotor(1, 0);
+         * myRobot->setupBump(2, 22);
+         * MotorHandle wheel = myRobot->motorHandle(1);
+         * BumpHandle bumper = myRobot->bumpHandle(2);
+         *
+         * while (!bumper.pressed()) {
+         *   wheel.drive(120);
+         * }
+         * wheel.stop();
+         * @endcode
+         */
+     ServoHandle servoHandle(int id);
+     MotorHandle motorHandle(int id);
+     PingHandle pingHandle(int id);
+     BumpHandle bumpHandle(int id);
+     IRHandle irHandle(int id);
+
 protected:
-     // Tracks which pins are being used and which are free
-     bool analogPins[16];
-     bool digitalPins[54];
-     bool pcaPins[16];
+     // Handles use the same helpers as the id-based functions
+     friend class ServoHandle;
+     friend class MotorHandle;
+     friend class PingHandle;
+
+     // Tracks which pins are being used, and by what
+     PinMap pins;
 
      // Tracks which components are associated to what ID's / pins
-     PingSensor pingSensors[8];
-     Component bumpSensors[8];
-     Component irSensors[4];
-     Motor motors[4];
-     Motor servos[16];
+     PingSensor *pingSensors;
+     Component *bumpSensors;
+     IRSensor *irSensors;
+     Motor *motors;
+     Motor *servos;
+
+     // Room in the arrays above, and whether the robot allocated them itself
+     int maxPings;
+     int maxBumps;
+     int maxIR;
+     int maxMotors;
+     int maxServos;
+     bool ownsStorage;
+
+     // Finds the slot of an ID in the arrays above without scanning them
+     IDIndex<2 * KNW_MAX_PINGS> pingIndex;
+     IDIndex<2 * KNW_MAX_BUMPS> bumpIndex;
+     IDIndex<2 * KNW_MAX_IR> irIndex;
+     IDIndex<2 * KNW_MAX_MOTORS> motorIndex;
+     IDIndex<2 * KNW_MAX_SERVOS> servoIndex;
 
      // Tracks how many of each component the robot currently has attached
      int numPings;
@@ -1224,11 +2128,14 @@ protected:
      const int conductivityDigitalPin2 = 13;
      const int conductivityAnalogPin1 = 2;
      const int conductivityAnalogPin2 = 3;
+     AnalogSampler analogSampler;
+     int analogOversample;
+     ConductivityProbe conductivityProbe;
+     PingScheduler pingScheduler;
+     TemperatureProbe temperatureProbe;
 
      // Instance variables used in conjunction with the keypad
-     bool entered;
-     int numEntered;
-     char DATA[17];
+     KeypadEditor keypadEditor;
      byte ROWS = 4;
      byte COLS = 4;
      char keys[4][4] = {
@@ -1243,33 +2150,65 @@ protected:
 
      // Used to control the LCD and PCA boards
      LiquidCrystal_I2C *lcd;
+     LCDBuffer screen; // what the LCD should show; sent by showLCD() or flushLCD()
+     bool lcdBuffered;
      Adafruit_PWMServoDriver *pwm;
-
-     // Instance variables used in conjunction with the IR sensor
-     unsigned char necState;
-     int num_chars;
-     unsigned long prev_time;
-
-     unsigned char IRChar, IRCharBitMask;
-     char buffer[8];
-     bool receiverState = false;
-     unsigned long cur_time, ticks;
+     bool pcaPresent; // true if the PCA board answered when the robot started
+
+     // The IR sensor whose scan getIR() returns
+     int lastIR;
+
+     // Timed motions waiting for the scheduler to end them
+     struct TimedMotion
+     {
+          int action; // scheduler task number, -1 when the slot is free
+          KNWRobot *robot;
+          Motor *first;
+          Motor *second;
+          char end; // 'h' hold, 'o' pulses off, 's' stop at ZERO
+          void (*done)();
+     };
+     TimedMotion motions[KNW_MAX_TASKS];
+     KNWScheduler scheduler;
 
      // Miscellaneous functions
-     bool checkPin(int pin, char type); // check to see if avalible
+     int getPinOwnerID(int pin, char type, char owner); // ID of whatever has a pin
      int getPin(int id, char type);     // from an ID
      void secretFunction();
      void pcaRaw(int id, int pulseSize);
      void pcaRawTime(int id, int pulseSize, int duration);
 
+     // Servos and motors go through these so either backend ('d' or 'p') works
+     bool setupActuator(Motor &actuator, int id, int pin, int zero, char type, char owner);
+     Motor *getActuator(int id, char type);
+     void writeActuator(Motor &actuator, int value, bool stage = false);
+     void pulseActuator(Motor &actuator, int ticks, bool stage = false);
+     int contServoTicks(int speed);
+
+     PingSensor *getPingSensor(int id);
+
+     // Timed motion helpers
+     int startMotion(Motor *first, Motor *second, char end, int duration, void (*done)());
+     void endMotion(Motor *actuator, char end);
+     void cancelMotions(Motor *actuator);
+     void waitFor(int duration);
+     static void finishMotion(void *context);
+
+     // Shared by both constructors once the component storage is in place
+     void init(long lcdAddress);
+
      /** Functions that perform setup on components; note that these have not been 
         *   tested for use as reset functions
         */
      void setupKeypad();
      void setupLCD(long);
+     void showLCD(); // sends the screen unless the LCD is buffered
      void setupPWM();
      void setupSensors();
      void setupIR();
+     int getIRIndex(int id);
+     void collectIR(int index);
+     void updateTemperature();
 };
 
 #endif // SRC_KNW_KNWROBOT_H_
@@ -0,0 +1,144 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  KNWScheduler.cpp - A fixed table of timed tasks run from update().
+
+  A task number is its slot in the low byte and the slot's generation
+  (bumped every time the slot is reused) in the next 7 bits, so it stays a
+  positive int on the arduino and a stale number never matches a new task.
+*/
+
+#include "KNWScheduler.h"
+
+#define TASK_SLOT_MASK 0xFF
+#define TASK_GENERATION_SHIFT 8
+#define TASK_GENERATION_MASK 0x7F
+
+KNWScheduler::KNWScheduler()
+{
+    for (uint8_t i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        tasks[i].active = false;
+        tasks[i].generation = 0;
+    }
+}
+
+int KNWScheduler::after(unsigned long delayMs, KNWTaskFunction task, void *context)
+{
+    return add(delayMs, 0, task, nullptr, context);
+}
+
+int KNWScheduler::after(unsigned long delayMs, void (*task)())
+{
+    return add(delayMs, 0, nullptr, task, nullptr);
+}
+
+int KNWScheduler::every(unsigned long periodMs, KNWTaskFunction task, void *context)
+{
+    if (periodMs == 0)
+        return -1;
+    return add(periodMs, periodMs, task, nullptr, context);
+}
+
+int KNWScheduler::every(unsigned long periodMs, void (*task)())
+{
+    if (periodMs == 0)
+        return -1;
+    return add(periodMs, periodMs, nullptr, task, nullptr);
+}
+
+int KNWScheduler::add(unsigned long delayMs, unsigned long period, KNWTaskFunction function,
+                      void (*plainFunction)(), void *context)
+{
+    if (function == nullptr && plainFunction == nullptr)
+        return -1;
+
+    for (uint8_t i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        Task &task = tasks[i];
+        if (task.active)
+            continue;
+        task.active = true;
+        task.generation = (task.generation + 1) & TASK_GENERATION_MASK;
+        task.due = millis() + delayMs;
+        task.period = period;
+        task.function = function;
+        task.plainFunction = plainFunction;
+        task.context = context;
+        return ((int)task.generation << TASK_GENERATION_SHIFT) | i;
+    }
+    return -1;
+}
+
+int KNWScheduler::slotOf(int task) const
+{
+    if (task < 0)
+        return -1;
+    int slot = task & TASK_SLOT_MASK;
+    if (slot >= KNW_MAX_TASKS)
+        return -1;
+    const Task &t = tasks[slot];
+    if (!t.active || t.generation != ((task >> TASK_GENERATION_SHIFT) & TASK_GENERATION_MASK))
+        return -1;
+    return slot;
+}
+
+bool KNWScheduler::cancel(int task)
+{
+    int slot = slotOf(task);
+    if (slot == -1)
+        return false;
+    tasks[slot].active = false;
+    return true;
+}
+
+bool KNWScheduler::pending(int task) const
+{
+    return slotOf(task) != -1;
+}
+
+unsigned long KNWScheduler::remaining(int task) const
+{
+    int slot = slotOf(task);
+    if (slot == -1)
+        return 0;
+    long left = (long)(tasks[slot].due - millis());
+    return left > 0 ? left : 0;
+}
+
+uint8_t KNWScheduler::count() const
+{
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        if (tasks[i].active)
+            n++;
+    }
+    return n;
+}
+
+void KNWScheduler::update()
+{
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < KNW_MAX_TASKS; i++)
+    {
+        Task &task = tasks[i];
+        if (!task.active || (long)(now - task.due) < 0)
+            continue;
+
+        // Reschedule (or free the slot) first, so the task can schedule or
+        // cancel tasks itself, including this one
+        KNWTaskFunction function = task.function;
+        void (*plainFunction)() = task.plainFunction;
+        void *context = task.context;
+        if (task.period != 0)
+            task.due += task.period;
+        else
+            task.active = false;
+
+        if (function != nullptr)
+            function(context);
+        else
+            plainFunction();
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_KNWSCHEDULER_H_
+#define SRC_KNW_KNWSCHEDULER_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// How many tasks can be waiting at the same time
+#define KNW_MAX_TASKS 8
+
+typedef void (*KNWTaskFunction)(void *context);
+
+/**
+ * Runs functions later, or over and over, without delay().
+ *
+ * Nothing runs in the background: tasks are run from update(), which you
+ * call from loop() (or from any loop that waits for something). A task runs
+ * on the first update() at or after its due time, so the more often update()
+ * is called the more precise the timing is.
+ *
+ * Every scheduled task gets a number that can be passed to pending() and
+ * cancel(). Numbers are not reused right away, so asking about a task that
+ * has already finished safely reports that it isn't pending.
+ *
+ * Example usage:
+ *
+ * @code
+ * KNWScheduler scheduler;
+ *
+ * void blink() {
+ *   digitalWrite(13, !digitalRead(13));
+ * }
+ *
+ * void setup() {
+ *   pinMode(13, OUTPUT);
+ *   scheduler.every(500, blink);
+ * }
+ *
+ * void loop() {
+ *   scheduler.update();
+ *   // Keep driving
+ * }
+ * @endcode
+ */
+class KNWScheduler
+{
+public:
+     KNWScheduler();
+
+     /**
+      * Runs task once, delayMs milliseconds from now. Returns the task's
+      * number, or -1 if KNW_MAX_TASKS tasks are already waiting.
+      */
+     int after(unsigned long delayMs, KNWTaskFunction task, void *context);
+     int after(unsigned long delayMs, void (*task)());
+
+     /**
+      * Runs task every periodMs milliseconds, starting periodMs from now,
+      * until it is cancelled. Returns the task's number, or -1.
+      */
+     int every(unsigned long periodMs, KNWTaskFunction task, void *context);
+     int every(unsigned long periodMs, void (*task)());
+
+     // Stops a task from running. Returns false if it wasn't pending.
+     bool cancel(int task);
+
+     // true until a one-shot task has run, or a repeating one is cancelled
+     bool pending(int task) const;
+
+     // Milliseconds until the task runs next, or 0 if it is due or not pending
+     unsigned long remaining(int task) const;
+
+     // Number of tasks waiting
+     uint8_t count() const;
+
+     // Runs every task that is due
+     void update();
+
+private:
+     struct Task
+     {
+          bool active;
+          uint8_t generation;
+          unsigned long due;
+          unsigned long period; // 0 for tasks that run once
+          KNWTaskFunction function;
+          void (*plainFunction)();
+          void *context;
+     };
+
+     Task tasks[KNW_MAX_TASKS];
+
+     int add(unsigned long delayMs, unsigned long period, KNWTaskFunction function,
+             void (*plainFunction)(), void *context);
+     int slotOf(int task) const;
+};
+
+#endif // SRC_KNW_KNWSCHEDULER_H_
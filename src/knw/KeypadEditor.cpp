@@ -0,0 +1,162 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  KeypadEditor.cpp - Keypad line editor driven by the keypad's events.
+
+  The keypad library calls its listener with just the key, on every state
+  change (pressed, held, released), so the listener looks the key up to
+  only act on presses, and reaches the editor through a static owner
+  pointer like the other background engines.
+*/
+
+#include "KeypadEditor.h"
+
+KeypadEditor *KeypadEditor::owner = nullptr;
+
+KeypadEditor::KeypadEditor()
+{
+    keypad = nullptr;
+    screen = nullptr;
+    mode = 'n';
+    currentState = KEYPAD_IDLE;
+    maxLength = KEYPAD_MAX_LENGTH;
+    row = 0;
+    col = 0;
+    count = 0;
+    letter = 0;
+    line[0] = '\0';
+}
+
+KeypadEditor::~KeypadEditor()
+{
+    // The keypad may already be gone, so only stop taking its events
+    if (owner == this)
+        owner = nullptr;
+}
+
+void KeypadEditor::begin(Keypad *keypad, LCDBuffer *screen)
+{
+    this->keypad = keypad;
+    this->screen = screen;
+    owner = this;
+    if (keypad != nullptr)
+        keypad->addEventListener(keyEvent);
+}
+
+bool KeypadEditor::start(char mode, int maxLength, uint8_t row, uint8_t col)
+{
+    if ((mode != 'n' && mode != 'l' && mode != 'a') || maxLength < 1 || maxLength > KEYPAD_MAX_LENGTH)
+        return false;
+    this->mode = mode;
+    this->maxLength = maxLength;
+    this->row = row;
+    this->col = col;
+    count = 0;
+    letter = 0;
+    line[0] = '\0';
+    currentState = KEYPAD_EDITING;
+    return true;
+}
+
+void KeypadEditor::cancel()
+{
+    if (currentState == KEYPAD_EDITING)
+        currentState = KEYPAD_CANCELLED;
+}
+
+void KeypadEditor::poll()
+{
+    if (currentState == KEYPAD_EDITING && keypad != nullptr)
+        keypad->getKeys();
+}
+
+void KeypadEditor::feed(char key)
+{
+    if (currentState != KEYPAD_EDITING)
+        return;
+
+    if (key == '#')
+    {
+        // A letter line is finished by its letter
+        if (mode != 'l')
+            currentState = KEYPAD_DONE;
+    }
+    else if (key == '*')
+    {
+        if (count == 0)
+        {
+            currentState = KEYPAD_CANCELLED;
+            return;
+        }
+        count--;
+        line[count] = '\0';
+        echo(count, ' ');
+        // Erasing a letter leaves the one before it, if any, as the result
+        if (letter != 0)
+        {
+            letter = 0;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                if (line[i] >= 'A' && line[i] <= 'D')
+                    letter = line[i];
+            }
+        }
+    }
+    else if (count < maxLength)
+    {
+        bool isLetter = key >= 'A' && key <= 'D';
+        bool isDigit = key >= '0' && key <= '9';
+        if ((isLetter && mode == 'n') || (isDigit && mode == 'l') || (!isLetter && !isDigit))
+            return;
+        echo(count, key);
+        line[count++] = key;
+        line[count] = '\0';
+        if (isLetter)
+        {
+            letter = key;
+            if (mode == 'l')
+                currentState = KEYPAD_DONE;
+        }
+    }
+}
+
+char KeypadEditor::state() const
+{
+    return currentState;
+}
+
+const char *KeypadEditor::text() const
+{
+    return line;
+}
+
+int KeypadEditor::length() const
+{
+    return count;
+}
+
+int KeypadEditor::result() const
+{
+    if (currentState != KEYPAD_DONE)
+        return -1;
+    if (letter != 0)
+        return letter;
+    return atoi(line);
+}
+
+void KeypadEditor::keyEvent(char key)
+{
+    if (owner == nullptr || owner->currentState != KEYPAD_EDITING)
+        return;
+    int index = owner->keypad->findInList(key);
+    if (index != -1 && owner->keypad->key[index].kstate == PRESSED)
+        owner->feed(key);
+}
+
+void KeypadEditor::echo(uint8_t position, char key)
+{
+    if (screen == nullptr)
+        return;
+    screen->setCursor(col + position, row);
+    screen->write(key);
+}
@@ -0,0 +1,111 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_KEYPADEDITOR_H_
+#define SRC_KNW_KEYPADEDITOR_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "Keypad.h"
+#include "LCDBuffer.h"
+
+// Most characters in a line, one LCD row
+#define KEYPAD_MAX_LENGTH 16
+
+// What the editor is doing, from state()
+#define KEYPAD_IDLE 'i'
+#define KEYPAD_EDITING 'e'
+#define KEYPAD_DONE 'd'
+#define KEYPAD_CANCELLED 'c'
+
+/**
+ * Edits a line typed on the keypad without waiting for it.
+ *
+ * The editor hooks the keypad's event listener, so poll() only scans the
+ * keypad (no more often than its debounce time) and handles whatever keys
+ * were pressed since the last scan, then returns. A sketch can drive motors
+ * and read sensors in the same loop a menu is being answered in.
+ *
+ * Keys typed are echoed into an LCDBuffer, one character each, so only the
+ * changed character goes out to the LCD.
+ *
+ * - '#' finishes the line
+ * - '*' erases the last character, or cancels when the line is empty
+ * - mode 'n' takes digits only; mode 'l' takes one letter (A - D), which
+ *   finishes the line right away; mode 'a' takes digits and letters, as
+ *   KNWRobot::getKeypadInput() always has
+ * - keys past maxLength are ignored
+ *
+ * Example usage:
+ *
+ * @code
+ * KeypadEditor editor;
+ * editor.begin(keypad, &screen);
+ * editor.start('n', 3, 1, 0);
+ *
+ * void loop() {
+ *   editor.poll();
+ *   if (editor.state() == KEYPAD_DONE) {
+ *     int angle = editor.result();
+ *   }
+ *   // Keep driving
+ * }
+ * @endcode
+ */
+class KeypadEditor
+{
+public:
+     KeypadEditor();
+     ~KeypadEditor();
+
+     // Takes over the keypad's event listener, echoing keys to screen (if given)
+     void begin(Keypad *keypad, LCDBuffer *screen);
+
+     /**
+      * Starts a new, empty line echoed from col on row. Returns false if mode
+      * isn't 'n', 'l' or 'a' or maxLength isn't 1 - KEYPAD_MAX_LENGTH. The
+      * LCD isn't cleared; print over the field first if it needs to be blank.
+      */
+     bool start(char mode = 'n', int maxLength = KEYPAD_MAX_LENGTH, uint8_t row = 0, uint8_t col = 0);
+
+     // Cancels the line being edited
+     void cancel();
+
+     // Scans the keypad when editing; keys pressed are handled through feed()
+     void poll();
+
+     // Handles one key as if it was pressed on the keypad
+     void feed(char key);
+
+     // KEYPAD_IDLE, KEYPAD_EDITING, KEYPAD_DONE or KEYPAD_CANCELLED
+     char state() const;
+
+     // The line so far
+     const char *text() const;
+     int length() const;
+
+     // Once done: the letter's code if one was typed, otherwise the number; -1 before
+     int result() const;
+
+private:
+     static KeypadEditor *owner; // gets the keypad's events
+     static void keyEvent(char key);
+
+     Keypad *keypad;
+     LCDBuffer *screen;
+     char mode;
+     char currentState;
+     uint8_t maxLength;
+     uint8_t row;
+     uint8_t col;
+     uint8_t count;
+     char letter; // last letter typed in mode 'a' or 'l', 0 for none
+     char line[KEYPAD_MAX_LENGTH + 1];
+
+     void echo(uint8_t position, char key);
+};
+
+#endif // SRC_KNW_KEYPADEDITOR_H_
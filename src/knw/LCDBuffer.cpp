@@ -0,0 +1,178 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  LCDBuffer.cpp - RAM copy of the LCD that only sends what changed.
+
+  Moving the cursor is one command, the same cost as one character, so an
+  unchanged character between two changes is rewritten rather than jumped
+  over (LCD_MAX_GAP). The screen's cursor moves one column right after
+  every character, which is what lets back to back runs skip setCursor().
+
+  Every step() rescans the buffer from the top left for the first change;
+  with 32 characters that costs less than one byte on the I2C bus.
+*/
+
+#include "LCDBuffer.h"
+
+// Longest stretch of unchanged characters rewritten to join two changes
+#define LCD_MAX_GAP 1
+
+LCDBuffer::LCDBuffer()
+{
+    lcd = nullptr;
+    memset(wanted, ' ', sizeof(wanted));
+    memset(shown, ' ', sizeof(shown));
+    stale = 0xFFFFFFFFUL;
+    col = 0;
+    row = 0;
+    lcdCol = -1;
+    lcdRow = -1;
+    clearing = false;
+    clearDone = 0;
+}
+
+void LCDBuffer::begin(LCD *lcd)
+{
+    this->lcd = lcd;
+    memset(wanted, ' ', sizeof(wanted));
+    memset(shown, ' ', sizeof(shown));
+    stale = 0;
+    col = 0;
+    row = 0;
+    lcdCol = 0;
+    lcdRow = 0;
+    clearing = false;
+}
+
+void LCDBuffer::clear()
+{
+    memset(wanted, ' ', sizeof(wanted));
+    col = 0;
+    row = 0;
+}
+
+void LCDBuffer::setCursor(uint8_t col, uint8_t row)
+{
+    this->col = col;
+    this->row = row < LCD_ROWS ? row : LCD_ROWS - 1;
+}
+
+size_t LCDBuffer::write(uint8_t value)
+{
+    if (col < LCD_COLS)
+        wanted[row][col] = value;
+    if (col < 255)
+        col++;
+    return 1;
+}
+
+int LCDBuffer::flush()
+{
+    if (lcd == nullptr)
+        return 0;
+
+    int sent = 0;
+    while (pending())
+    {
+        // Only blocks when a clear is still running
+        while (!ready())
+            ;
+        sent += step();
+    }
+    return sent;
+}
+
+int LCDBuffer::step()
+{
+    if (lcd == nullptr || !ready())
+        return 0;
+
+    for (uint8_t r = 0; r < LCD_ROWS; r++)
+    {
+        for (uint8_t c = 0; c < LCD_COLS; c++)
+        {
+            if (!changed(c, r))
+                continue;
+
+            // Rewriting a character the cursor is just short of beats moving it
+            uint8_t start = c;
+            if (lcdRow == r && lcdCol >= 0 && lcdCol < c && c - lcdCol <= LCD_MAX_GAP)
+                start = lcdCol;
+
+            // Grow the run over every change that is close enough to join
+            uint8_t end = c + 1;
+            for (uint8_t next = end; next < LCD_COLS && next - end <= LCD_MAX_GAP && end - start < LCD_STEP_CHARS; next++)
+            {
+                if (changed(next, r))
+                    end = min(next + 1, start + LCD_STEP_CHARS);
+            }
+
+            int sent = 0;
+            if (lcdRow != r || lcdCol != start)
+            {
+                lcd->setCursor(start, r);
+                sent++;
+            }
+            // One write for the run so the LCD can stream it
+            lcd->write((const uint8_t *)&wanted[r][start], end - start);
+            memcpy(&shown[r][start], &wanted[r][start], end - start);
+            for (c = start; c < end; c++)
+                stale &= ~(1UL << (r * LCD_COLS + c));
+            lcdCol = end;
+            lcdRow = r;
+            return sent + end - start;
+        }
+    }
+    return 0;
+}
+
+bool LCDBuffer::pending() const
+{
+    if (stale != 0)
+        return true;
+    return memcmp(wanted, shown, sizeof(wanted)) != 0;
+}
+
+void LCDBuffer::clearNow()
+{
+    clear();
+    memset(shown, ' ', sizeof(shown));
+    stale = 0;
+    if (lcd == nullptr)
+        return;
+    // Busy-waits (up to HOME_CLEAR_EXEC) for an earlier clear before sending another
+    while (!ready())
+        ;
+    lcd->startClear();
+    clearing = true;
+    clearDone = micros() + HOME_CLEAR_EXEC;
+    lcdCol = 0;
+    lcdRow = 0;
+}
+
+void LCDBuffer::invalidate()
+{
+    stale = 0xFFFFFFFFUL;
+    lcdCol = -1;
+    lcdRow = -1;
+}
+
+char LCDBuffer::at(uint8_t col, uint8_t row) const
+{
+    if (col >= LCD_COLS || row >= LCD_ROWS)
+        return ' ';
+    return wanted[row][col];
+}
+
+bool LCDBuffer::changed(uint8_t col, uint8_t row) const
+{
+    return (stale & (1UL << (row * LCD_COLS + col))) != 0 || wanted[row][col] != shown[row][col];
+}
+
+bool LCDBuffer::ready()
+{
+    if (clearing && (long)(micros() - clearDone) < 0)
+        return false;
+    clearing = false;
+    return true;
+}
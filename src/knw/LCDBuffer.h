@@ -0,0 +1,110 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_LCDBUFFER_H_
+#define SRC_KNW_LCDBUFFER_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "LCD.h"
+
+#define LCD_COLS 16
+#define LCD_ROWS 2
+
+// Most characters step() sends at once, one I2C transaction's worth
+#define LCD_STEP_CHARS 4
+
+/**
+ * A copy of the LCD screen kept in RAM.
+ *
+ * Printing to the buffer only changes the copy; flush() then compares it
+ * with what is on the screen and sends just the characters that changed.
+ * Every character or command sent to an I2C LCD is 4 bus transactions, so
+ * a status line reprinted every loop costs nothing when its text hasn't
+ * changed, and only the digits that did when it has.
+ *
+ * Changes close together are sent as one run, rewriting the unchanged
+ * characters between them when that is cheaper than moving the cursor,
+ * and the cursor is only moved when it isn't already where the next run
+ * starts.
+ *
+ * step() sends the changes a few characters at a time, so a loop that calls
+ * it never waits on the LCD for more than one short run. Clearing the screen
+ * doesn't wait for the LCD either: the 2 ms it takes are kept as a deadline,
+ * and nothing is sent until it has passed.
+ *
+ * Example usage:
+ *
+ * @code
+ * LCDBuffer screen;
+ * screen.begin(lcd);
+ *
+ * void loop() {
+ *   screen.setCursor(0, 1);
+ *   screen.print(distance);
+ *   screen.print("cm  ");
+ *   screen.flush();
+ * }
+ * @endcode
+ */
+class LCDBuffer : public Print
+{
+public:
+     LCDBuffer();
+
+     // Takes over an LCD that was just begun, so its screen is blank
+     void begin(LCD *lcd);
+
+     // Blanks the buffer and homes its cursor
+     void clear();
+
+     // Moves the buffer's cursor; rows past the last one go to the last one
+     void setCursor(uint8_t col, uint8_t row);
+
+     // Puts a character in the buffer; characters past the end of a row are dropped
+     size_t write(uint8_t value);
+     using Print::write;
+
+     // Sends what changed since the last flush. Returns the characters and commands sent.
+     int flush();
+
+     /**
+      * Sends the next change, at most a cursor move and LCD_STEP_CHARS
+      * characters, unless the LCD is still busy clearing. Returns the
+      * characters and commands sent, 0 if there was nothing it could send.
+      */
+     int step();
+
+     // true while something in the buffer isn't on the screen yet
+     bool pending() const;
+
+     // Clears the screen itself and blanks both copies, without diffing. Doesn't
+     // wait for this clear, but busy-waits for an earlier one still running.
+     void clearNow();
+
+     // Forgets what is on the screen, so the next flush() sends everything
+     void invalidate();
+
+     // Character at a position of the buffer
+     char at(uint8_t col, uint8_t row) const;
+
+private:
+     LCD *lcd;
+     char wanted[LCD_ROWS][LCD_COLS];
+     char shown[LCD_ROWS][LCD_COLS];
+     uint32_t stale; // one bit per character whose shown copy can't be trusted
+     uint8_t col;
+     uint8_t row;
+     int8_t lcdCol; // where the screen's cursor is, -1 if unknown
+     int8_t lcdRow;
+     bool clearing; // true until clearDone, when the LCD takes commands again
+     unsigned long clearDone;
+
+     bool changed(uint8_t col, uint8_t row) const;
+     bool ready();
+};
+
+#endif // SRC_KNW_LCDBUFFER_H_
@@ -0,0 +1,170 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  PinMap.cpp - Bit packed pin reservations with their owners.
+
+  Owners are stored as their index in PIN_OWNERS plus 1, so 0 is free and
+  every kind fits in a nibble; even pins use the low nibble of a byte and
+  odd pins the high one. Owners not in the list share the last code, '?',
+  so a taken pin never reads as free.
+*/
+
+#include "PinMap.h"
+
+static const char PIN_OWNERS[] = "xkcubrsmit?";
+
+static uint8_t ownerCode(char owner)
+{
+    uint8_t i = 0;
+    while (PIN_OWNERS[i + 1] != '\0' && PIN_OWNERS[i] != owner)
+        i++;
+    return i + 1;
+}
+
+PinMap::PinMap()
+{
+    clear();
+}
+
+void PinMap::clear()
+{
+    memset(digitalOwners, 0, sizeof(digitalOwners));
+    memset(analogOwners, 0, sizeof(analogOwners));
+    memset(pcaOwners, 0, sizeof(pcaOwners));
+    clearConflict();
+}
+
+bool PinMap::exists(char space, int pin)
+{
+    if (space == 'd')
+        return pin >= 0 && pin < PIN_DIGITAL_COUNT;
+    if (space == 'a')
+        return pin >= 0 && pin < PIN_ANALOG_COUNT;
+    if (space == 'p')
+        return pin >= 0 && pin < PIN_PCA_COUNT;
+    return false;
+}
+
+bool PinMap::free(char space, int pin) const
+{
+    if (!exists(space, pin))
+        return false;
+    return owner(space, pin) == 0;
+}
+
+char PinMap::owner(char space, int pin) const
+{
+    if (!exists(space, pin))
+        return 0;
+    uint8_t code = owners(space)[pin >> 1];
+    code = (pin & 1) ? code >> 4 : code & 0x0F;
+    return code == 0 ? 0 : PIN_OWNERS[code - 1];
+}
+
+bool PinMap::reserve(char space, int pin, char owner, int id)
+{
+    if (!free(space, pin))
+    {
+        fail(space, pin, owner, id);
+        return false;
+    }
+    set(space, pin, owner);
+    return true;
+}
+
+bool PinMap::reserve(char space, int pin1, int pin2, char owner, int id)
+{
+    if (!free(space, pin1))
+    {
+        fail(space, pin1, owner, id);
+        return false;
+    }
+    if (pin2 != -1 && pin2 != pin1 && !free(space, pin2))
+    {
+        fail(space, pin2, owner, id);
+        return false;
+    }
+    set(space, pin1, owner);
+    if (pin2 != -1)
+        set(space, pin2, owner);
+    return true;
+}
+
+void PinMap::release(char space, int pin)
+{
+    if (!exists(space, pin))
+        return;
+    owners(space)[pin >> 1] &= (pin & 1) ? 0x0F : 0xF0;
+}
+
+void PinMap::fill(char space, bool *taken) const
+{
+    int count = space == 'd' ? PIN_DIGITAL_COUNT : space == 'a' ? PIN_ANALOG_COUNT : PIN_PCA_COUNT;
+    for (int pin = 0; pin < count; pin++)
+        taken[pin] = !free(space, pin);
+}
+
+bool PinMap::conflict() const
+{
+    return lastSpace != 0;
+}
+
+char PinMap::conflictSpace() const
+{
+    return lastSpace;
+}
+
+int PinMap::conflictPin() const
+{
+    return lastPin;
+}
+
+char PinMap::conflictOwner() const
+{
+    return lastOwner;
+}
+
+char PinMap::conflictWanted() const
+{
+    return lastWanted;
+}
+
+int PinMap::conflictID() const
+{
+    return lastID;
+}
+
+void PinMap::clearConflict()
+{
+    lastSpace = 0;
+    lastPin = -1;
+    lastOwner = 0;
+    lastWanted = 0;
+    lastID = -1;
+}
+
+uint8_t *PinMap::owners(char space)
+{
+    return space == 'd' ? digitalOwners : space == 'a' ? analogOwners : pcaOwners;
+}
+
+const uint8_t *PinMap::owners(char space) const
+{
+    return space == 'd' ? digitalOwners : space == 'a' ? analogOwners : pcaOwners;
+}
+
+void PinMap::set(char space, int pin, char owner)
+{
+    uint8_t code = ownerCode(owner);
+    uint8_t &pair = owners(space)[pin >> 1];
+    pair = (pin & 1) ? (pair & 0x0F) | (code << 4) : (pair & 0xF0) | code;
+}
+
+void PinMap::fail(char space, int pin, char owner, int id)
+{
+    lastSpace = space;
+    lastPin = pin;
+    lastOwner = this->owner(space, pin);
+    lastWanted = owner;
+    lastID = id;
+}
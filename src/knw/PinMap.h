@@ -0,0 +1,99 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_PINMAP_H_
+#define SRC_KNW_PINMAP_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// Pins in each space: 'd' digital, 'a' analog, 'p' PCA board channels
+#define PIN_DIGITAL_COUNT 54
+#define PIN_ANALOG_COUNT 16
+#define PIN_PCA_COUNT 16
+
+/**
+ * Keeps track of which pins are taken, and by what.
+ *
+ * Each space keeps 4 bits per pin naming the kind of owner, 0 for a free
+ * pin, 43 bytes for all 86 pins. Owners are the same characters KNWConfig
+ * uses ('u' ping, 'b' bump, 'r' IR, 's' servo, 'm' DC motor, 'i' incline,
+ * 't' temperature) plus the robot's own 'x' serial, 'k' keypad and
+ * 'c' conductivity probe; any other owner is kept as '?'.
+ *
+ * A component with two pins reserves both or neither. When a reservation
+ * fails, the map remembers what was asked for and what was in the way, so
+ * the sketch can find out why a setup function returned false.
+ *
+ * Example usage:
+ *
+ * @code
+ * PinMap pins;
+ * pins.reserve('d', 24, 25, 'u', 1); // ping sensor 1
+ * if (!pins.reserve('d', 25, 'b', 2)) {
+ *   // pins.conflictOwner() is 'u', pins.conflictPin() is 25
+ * }
+ * @endcode
+ */
+class PinMap
+{
+public:
+     PinMap();
+
+     // Frees every pin and forgets the last conflict
+     void clear();
+
+     // true if the pin exists in the space
+     static bool exists(char space, int pin);
+
+     // true if the pin exists and nothing has it
+     bool free(char space, int pin) const;
+
+     // Kind of the pin's owner, or 0 if it is free or doesn't exist
+     char owner(char space, int pin) const;
+
+     /**
+      * Gives a pin to an owner. Returns false, and records the conflict, if
+      * the pin doesn't exist or is already taken. id is only kept for the
+      * conflict report; use -1 for owners without one.
+      */
+     bool reserve(char space, int pin, char owner, int id = -1);
+
+     // Same, for a component with two pins; pin2 may equal pin1, or be -1 for none
+     bool reserve(char space, int pin1, int pin2, char owner, int id = -1);
+
+     // Frees a pin, e.g. when the component on it failed to start
+     void release(char space, int pin);
+
+     // Copies the taken flags of a space into an array of bools, one per pin
+     void fill(char space, bool *taken) const;
+
+     // The last failed reservation; conflictOwner() is 0 if the pin doesn't exist
+     bool conflict() const;
+     char conflictSpace() const;
+     int conflictPin() const;
+     char conflictOwner() const;
+     char conflictWanted() const;
+     int conflictID() const;
+     void clearConflict();
+
+private:
+     uint8_t digitalOwners[PIN_DIGITAL_COUNT / 2];
+     uint8_t analogOwners[PIN_ANALOG_COUNT / 2];
+     uint8_t pcaOwners[PIN_PCA_COUNT / 2];
+
+     char lastSpace; // 0 when there is no conflict
+     int lastPin;
+     char lastOwner;
+     char lastWanted;
+     int lastID;
+
+     uint8_t *owners(char space);
+     const uint8_t *owners(char space) const;
+     void set(char space, int pin, char owner);
+     void fail(char space, int pin, char owner, int id);
+};
+
+#endif // SRC_KNW_PINMAP_H_
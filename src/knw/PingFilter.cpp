@@ -0,0 +1,150 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  PingFilter.cpp - Rolling-window filtering of ping readings.
+
+  The window is a small ring of the last readings. The filtered value is
+  worked out when a reading is added, so value() is free to call from
+  loop() as often as it likes. With at most PING_WINDOW_MAX readings an
+  insertion sort is the cheapest way to order them.
+*/
+
+#include "PingFilter.h"
+
+// Fixed point scale of the exponential filter's state
+#define PING_SMOOTH_SCALE 16
+
+PingFilter::PingFilter()
+{
+    filterType = 'n';
+    size = PING_WINDOW_DEFAULT;
+    clear();
+}
+
+bool PingFilter::setType(char type, uint8_t window)
+{
+    if (type != 'n' && type != 'm' && type != 't' && type != 'e')
+        return false;
+    if (window == 0 || window > PING_WINDOW_MAX)
+        return false;
+
+    filterType = type;
+    size = window;
+    clear();
+    return true;
+}
+
+char PingFilter::type() const
+{
+    return filterType;
+}
+
+uint8_t PingFilter::window() const
+{
+    return size;
+}
+
+void PingFilter::add(unsigned int mm)
+{
+    // Make room by dropping the oldest reading
+    if (count == size)
+    {
+        uint8_t oldest = (next + size - count) % size;
+        if (readings[oldest] != 0)
+            validCount--;
+        count--;
+    }
+    readings[next] = mm;
+    next = (next + 1) % size;
+    count++;
+    if (mm != 0)
+        validCount++;
+
+    if (filterType == 'n')
+    {
+        filtered = mm;
+        return;
+    }
+
+    if (filterType == 'e')
+    {
+        if (mm != 0)
+        {
+            long target = (long)mm * PING_SMOOTH_SCALE;
+            if (smoothed < 0)
+                smoothed = target;
+            else
+                smoothed += (target - smoothed) * 2 / (size + 1);
+        }
+        filtered = validCount == 0 ? 0 : (smoothed + PING_SMOOTH_SCALE / 2) / PING_SMOOTH_SCALE;
+        return;
+    }
+
+    // Sort the valid readings
+    unsigned int sorted[PING_WINDOW_MAX];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        unsigned int reading = readings[(next + size - count + i) % size];
+        if (reading == 0)
+            continue;
+        uint8_t j = n++;
+        while (j > 0 && sorted[j - 1] > reading)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = reading;
+    }
+
+    if (n == 0)
+        filtered = 0;
+    else if (filterType == 'm')
+        filtered = median(sorted, n);
+    else
+        filtered = trimmedMean(sorted, n);
+}
+
+void PingFilter::clear()
+{
+    next = 0;
+    count = 0;
+    validCount = 0;
+    smoothed = -1;
+    filtered = -1;
+}
+
+long PingFilter::value() const
+{
+    return filtered;
+}
+
+uint8_t PingFilter::valid() const
+{
+    return validCount;
+}
+
+uint8_t PingFilter::samples() const
+{
+    return count;
+}
+
+long PingFilter::median(unsigned int *sorted, uint8_t n) const
+{
+    if (n % 2 == 1)
+        return sorted[n / 2];
+    return ((long)sorted[n / 2 - 1] + sorted[n / 2] + 1) / 2;
+}
+
+long PingFilter::trimmedMean(unsigned int *sorted, uint8_t n) const
+{
+    uint8_t trim = n / 4;
+    if (trim == 0 && n >= 3)
+        trim = 1;
+
+    long sum = 0;
+    for (uint8_t i = trim; i < n - trim; i++)
+        sum += sorted[i];
+    uint8_t used = n - 2 * trim;
+    return (sum + used / 2) / used;
+}
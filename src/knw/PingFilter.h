@@ -0,0 +1,71 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_PINGFILTER_H_
+#define SRC_KNW_PINGFILTER_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// Most readings a filter can look back over, and how many it uses by default
+#define PING_WINDOW_MAX 9
+#define PING_WINDOW_DEFAULT 5
+
+/**
+ * Smooths the readings of one ping sensor over its last few pings.
+ *
+ * Readings are in millimeters. A lost echo (a reading of 0) is kept in the
+ * window but never averaged in, so one missed ping doesn't pull the distance
+ * to 0. valid() tells how many of the readings in the window actually had an
+ * echo, which is a measure of how much to trust value().
+ *
+ * The type of filter is one of:
+ * - 'n' - none, value() is the latest reading
+ * - 'm' - median of the valid readings; ignores single wild readings
+ * - 't' - trimmed mean: the average after dropping the highest and lowest
+ *   quarter (at least one each) of the valid readings
+ * - 'e' - exponential smoothing; each valid reading moves the value
+ *   2 / (window + 1) of the way towards it
+ */
+class PingFilter
+{
+public:
+     PingFilter();
+
+     // Picks the type of filter and window size. Returns false if either is invalid.
+     bool setType(char type, uint8_t window = PING_WINDOW_DEFAULT);
+     char type() const;
+     uint8_t window() const;
+
+     // Adds a reading in mm, 0 for a lost echo
+     void add(unsigned int mm);
+
+     // Forgets all readings
+     void clear();
+
+     // Filtered distance in mm, 0 if no reading in the window had an echo, or -1 if there are no readings
+     long value() const;
+
+     // Readings in the window that had an echo
+     uint8_t valid() const;
+
+     // Readings in the window, valid or not
+     uint8_t samples() const;
+
+private:
+     unsigned int readings[PING_WINDOW_MAX];
+     uint8_t size;
+     uint8_t next;
+     uint8_t count;
+     uint8_t validCount;
+     char filterType;
+     long smoothed; // Exponential filter state, in 1/16 mm; -1 before the first echo
+     long filtered;
+
+     long median(unsigned int *sorted, uint8_t n) const;
+     long trimmedMean(unsigned int *sorted, uint8_t n) const;
+};
+
+#endif // SRC_KNW_PINGFILTER_H_
@@ -0,0 +1,287 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  PingScheduler.cpp - Round-robin background pinging.
+
+  A ping is in flight from the moment its trigger goes out until either the
+  echo has been timed or its deadline (the sensor's start-up time plus the
+  echo time of its max distance) has passed. update() turns a finished ping
+  into a reading and, once the interval is up, pings the next sensor.
+*/
+
+#include "PingScheduler.h"
+#include "KNWRobot.h"
+
+#if TIMER_ENABLED == true && defined(__AVR__) && !defined(KNW_PING_NO_TIMER)
+#define PING_USE_TIMER 1
+#endif
+
+// NewPing only has one timer callback, so only one scheduler can use it
+static PingScheduler *timerScheduler;
+
+// How long an echo from sensor's max distance lasts
+static unsigned long maxEchoTime(const PingSensor &sensor)
+{
+    unsigned int maxDistance = min(sensor.MAX_DISTANCE, MAX_SENSOR_DISTANCE);
+    return (unsigned long)maxDistance * US_ROUNDTRIP_CM + (US_ROUNDTRIP_CM / 2);
+}
+
+#ifdef PING_USE_TIMER
+static void echoCheck()
+{
+    if (timerScheduler)
+        timerScheduler->checkEcho();
+}
+#endif
+
+PingScheduler::PingScheduler()
+{
+    sensors = nullptr;
+    count = 0;
+    current = 0;
+    interval = PING_INTERVAL_MS;
+    nextPing = 0;
+    active = false;
+    inFlight = false;
+    echoed = false;
+    echoUs = 0;
+    echoTime = 0;
+    soundSpeed = 0;
+    echoDeadline = 0;
+    echoHigh = false;
+    echoStart = 0;
+    for (uint8_t i = 0; i < PING_MAX_SENSORS; i++)
+        clear(i);
+}
+
+PingScheduler::~PingScheduler()
+{
+    stop();
+}
+
+bool PingScheduler::start(PingSensor *sensors, uint8_t count, unsigned int intervalMs)
+{
+    stop();
+    if (sensors == nullptr || count == 0)
+        return false;
+    if (timerScheduler != nullptr)
+        return false;
+
+    this->sensors = sensors;
+    this->count = min(count, (uint8_t)PING_MAX_SENSORS);
+    for (uint8_t i = 0; i < PING_MAX_SENSORS; i++)
+        clear(i);
+
+    // The first update() pings the first sensor
+    interval = intervalMs;
+    current = this->count - 1;
+    nextPing = millis();
+    active = true;
+    timerScheduler = this;
+    return true;
+}
+
+void PingScheduler::stop()
+{
+    if (!active)
+        return;
+    abort();
+    active = false;
+    timerScheduler = nullptr;
+}
+
+bool PingScheduler::running() const
+{
+    return active;
+}
+
+void PingScheduler::update()
+{
+    if (!active)
+        return;
+
+    collect();
+    if (!inFlight && (long)(millis() - nextPing) >= 0)
+    {
+        current = (current + 1) % count;
+        // Spaced from when this ping really goes out, in case update() was late
+        nextPing = millis() + interval;
+        ping();
+    }
+}
+
+void PingScheduler::wait()
+{
+    if (!active)
+        return;
+    while (inFlight)
+        collect();
+    nextPing = millis() + interval;
+}
+
+long PingScheduler::distance(uint8_t slot) const
+{
+    if (slot >= PING_MAX_SENSORS)
+        return -1;
+    return roundToCm(distances[slot]);
+}
+
+long PingScheduler::distanceMm(uint8_t slot) const
+{
+    if (slot >= PING_MAX_SENSORS)
+        return -1;
+    return distances[slot];
+}
+
+bool PingScheduler::setTemperature(int tenthsC)
+{
+    if (tenthsC < PING_MIN_TEMPERATURE || tenthsC > PING_MAX_TEMPERATURE)
+        return false;
+    // c = 331.3 + 0.606 * T m/s, which is 0.0606 per tenth of a degree
+    soundSpeed = 3313 + ((long)tenthsC * 606 + (tenthsC < 0 ? -500 : 500)) / 1000;
+    return true;
+}
+
+unsigned int PingScheduler::toMillimeters(unsigned long echoUs) const
+{
+    if (soundSpeed == 0)
+        return (echoUs * 10 + US_ROUNDTRIP_CM / 2) / US_ROUNDTRIP_CM;
+
+    // Half the round trip: us * (0.1 m/s) / 2 = us * speed / 20000 mm. At the
+    // longest echo (MAX_SENSOR_DISTANCE) this stays well inside 32 bits.
+    return (echoUs * soundSpeed + 10000) / 20000;
+}
+
+long PingScheduler::toCentimeters(unsigned long echoUs) const
+{
+    if (soundSpeed == 0)
+        return echoUs / US_ROUNDTRIP_CM;
+    return roundToCm(toMillimeters(echoUs));
+}
+
+long PingScheduler::roundToCm(long mm)
+{
+    if (mm <= 0)
+        return mm;
+    return (mm + 5) / 10;
+}
+
+unsigned long PingScheduler::time(uint8_t slot) const
+{
+    if (slot >= PING_MAX_SENSORS)
+        return 0;
+    return times[slot];
+}
+
+PingFilter *PingScheduler::filter(uint8_t slot)
+{
+    if (slot >= PING_MAX_SENSORS)
+        return nullptr;
+    return &filters[slot];
+}
+
+void PingScheduler::clear(uint8_t slot)
+{
+    if (slot >= PING_MAX_SENSORS)
+        return;
+    if (inFlight && slot == current)
+        abort();
+    distances[slot] = -1;
+    times[slot] = 0;
+    filters[slot].clear();
+}
+
+void PingScheduler::checkEcho()
+{
+#ifdef PING_USE_TIMER
+    if (inFlight && !echoed && sensors[current].SONAR->check_timer())
+    {
+        echoUs = sensors[current].SONAR->ping_result;
+        echoTime = millis();
+        echoed = true;
+    }
+#endif
+}
+
+void PingScheduler::ping()
+{
+    PingSensor &sensor = sensors[current];
+    echoed = false;
+    echoUs = 0;
+    echoDeadline = micros() + MAX_SENSOR_DELAY + maxEchoTime(sensor);
+    inFlight = true;
+
+#ifdef PING_USE_TIMER
+    // If the trigger fails (the last echo hasn't ended) no timer is started,
+    // and the deadline turns the ping into a lost one
+    sensor.SONAR->ping_timer(echoCheck);
+#else
+    echoHigh = false;
+    // An echo still going from an earlier ping would be timed instead of ours
+    if (digitalRead(sensor.ECHO) == HIGH)
+    {
+        echoDeadline = micros();
+        return;
+    }
+    // Same trigger pulse as NewPing, which may have left the pin as an input
+    pinMode(sensor.TRIG, OUTPUT);
+    digitalWrite(sensor.TRIG, LOW);
+    delayMicroseconds(4);
+    digitalWrite(sensor.TRIG, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(sensor.TRIG, LOW);
+#if ONE_PIN_ENABLED == true
+    pinMode(sensor.TRIG, INPUT);
+#endif
+#endif
+}
+
+void PingScheduler::collect()
+{
+    if (!inFlight)
+        return;
+#ifndef PING_USE_TIMER
+    pollEcho();
+#endif
+    if (echoed || (long)(micros() - echoDeadline) >= 0)
+        finish();
+}
+
+void PingScheduler::pollEcho()
+{
+    PingSensor &sensor = sensors[current];
+    unsigned long now = micros();
+    bool high = digitalRead(sensor.ECHO) == HIGH;
+    if (!echoHigh && high)
+    {
+        // The echo time is measured from here, so the deadline moves too
+        echoHigh = true;
+        echoStart = now;
+        echoDeadline = now + maxEchoTime(sensor);
+    }
+    else if (echoHigh && !high)
+    {
+        echoUs = now - echoStart;
+        echoTime = millis();
+        echoed = true;
+    }
+}
+
+void PingScheduler::finish()
+{
+#ifdef PING_USE_TIMER
+    NewPing::timer_stop();
+#endif
+    inFlight = false;
+    distances[current] = echoed ? toMillimeters(echoUs) : NO_ECHO;
+    times[current] = echoed ? echoTime : millis();
+    filters[current].add(distances[current]);
+}
+
+void PingScheduler::abort()
+{
+#ifdef PING_USE_TIMER
+    NewPing::timer_stop();
+#endif
+    inFlight = false;
+}
@@ -0,0 +1,160 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_PINGSCHEDULER_H_
+#define SRC_KNW_PINGSCHEDULER_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "NewPing.h"
+#include "PingFilter.h"
+
+// The most ping sensors a robot can set up
+#define PING_MAX_SENSORS 8
+
+// Air temperatures, in tenths of a degree C, that setTemperature() accepts
+#define PING_MIN_TEMPERATURE -400
+#define PING_MAX_TEMPERATURE 600
+
+// Time between two pings. An echo takes up to ~29ms to die down, so pinging
+// sooner than that can hear the previous sensor's echo.
+#define PING_INTERVAL_MS 33
+
+struct PingSensor;
+
+/**
+ * Pings a set of sensors one after another in the background.
+ *
+ * Every PING_INTERVAL_MS one sensor is pinged, going round the list, so with
+ * n sensors each one gets a fresh reading every n * PING_INTERVAL_MS. Only one
+ * sensor is ever pinging at a time, so they can't hear each other's echoes.
+ * Nothing waits for an echo: the latest distance of every sensor, and the
+ * millis() at which it came back, are kept for distance() and time(). Every
+ * reading is also added to the sensor's filter(), which smooths it over the
+ * last few pings.
+ *
+ * Echo times are turned into millimeters with toMillimeters(). Until
+ * setTemperature() is called that uses NewPing's US_ROUNDTRIP_CM; after, it
+ * uses the speed of sound at that air temperature, which changes by about
+ * 0.6 m/s (nearly 2mm per meter) per degree.
+ *
+ * Pings are started from update(), which you call from loop(). On the arduino
+ * the echo is timed by NewPing's timer 2 interrupt (the NewPing15Sensors
+ * example's approach), so timer 2 can't be used for anything else, like
+ * analogWrite() on pins 9 and 10 or tone(), while the scheduler is running.
+ * Where that timer isn't available, update() also times the echo itself, so
+ * the reading is only as precise as update() is frequent.
+ *
+ * Example usage:
+ *
+ * @code
+ * PingScheduler pings;
+ * pings.start(sensors, 3);
+ *
+ * void loop() {
+ *   pings.update();
+ *   if (pings.time(0) != 0 && pings.distance(0) < 30) {
+ *     // Something is close in front of sensor 0
+ *   }
+ * }
+ * @endcode
+ */
+class PingScheduler
+{
+public:
+     PingScheduler();
+     ~PingScheduler();
+
+     /**
+      * Starts pinging the first count sensors, one every intervalMs. Returns
+      * false if there are no sensors or another scheduler is using the timer.
+      */
+     bool start(PingSensor *sensors, uint8_t count,
+                unsigned int intervalMs = PING_INTERVAL_MS);
+
+     // Stops pinging. The last readings are kept.
+     void stop();
+
+     bool running() const;
+
+     // Starts the next ping when it is due, and finishes the one in flight
+     void update();
+
+     /**
+      * Waits for the ping in flight (if any) and pushes the next one back a
+      * full interval, so the caller can ping a sensor itself without crosstalk.
+      */
+     void wait();
+
+     // Latest distance in cm of a sensor (0 for no echo), or -1 if it has none yet
+     long distance(uint8_t slot) const;
+
+     // Same as distance(), in mm
+     long distanceMm(uint8_t slot) const;
+
+     // millis() when that distance came back, or 0 if it has none yet
+     unsigned long time(uint8_t slot) const;
+
+     // The filter fed with a sensor's readings, or nullptr for an invalid slot
+     PingFilter *filter(uint8_t slot);
+
+     // Forgets a sensor's readings; also call it before changing its NewPing
+     void clear(uint8_t slot);
+
+     /**
+      * Sets the air temperature, in tenths of a degree C, used to work out the
+      * speed of sound. Returns false if it is outside PING_MIN_TEMPERATURE to
+      * PING_MAX_TEMPERATURE.
+      */
+     bool setTemperature(int tenthsC);
+
+     // Round trip echo time in microseconds to a distance in mm (0 stays 0)
+     unsigned int toMillimeters(unsigned long echoUs) const;
+
+     // Round trip echo time to whole cm. Until setTemperature() is called this
+     // truncates, exactly like NewPing's ping_cm(); after, it is toMillimeters()
+     // rounded to the nearest cm.
+     long toCentimeters(unsigned long echoUs) const;
+
+     // A distance in mm rounded to the nearest cm; 0 and -1 are kept as they are
+     static long roundToCm(long mm);
+
+     // Called from the timer interrupt while an echo is expected
+     void checkEcho();
+
+private:
+     PingSensor *sensors;
+     uint8_t count;
+     uint8_t current; // sensor pinging now, or last pinged
+     unsigned int interval;
+     unsigned long nextPing;
+     bool active;
+
+     volatile bool inFlight;
+     volatile bool echoed;
+     volatile unsigned long echoUs; // round trip time, valid once echoed
+     volatile unsigned long echoTime; // millis() when the echo came back
+     unsigned long echoDeadline; // micros() after which the ping counts as lost
+
+     // Only used when the timer isn't available
+     bool echoHigh;
+     unsigned long echoStart;
+
+     // Speed of sound in 0.1 m/s, or 0 to use US_ROUNDTRIP_CM
+     unsigned int soundSpeed;
+
+     long distances[PING_MAX_SENSORS]; // mm
+     unsigned long times[PING_MAX_SENSORS];
+     PingFilter filters[PING_MAX_SENSORS];
+
+     void ping();
+     void collect();
+     void finish();
+     void abort();
+     void pollEcho();
+};
+
+#endif // SRC_KNW_PINGSCHEDULER_H_
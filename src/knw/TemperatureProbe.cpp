@@ -0,0 +1,111 @@
+// Copyright 2019 Southern Methodist University
+
+/*
+  TemperatureProbe.cpp - Background oversampling and fixed point calibration
+  of the temperature probe.
+
+  The slope is capped at 64 tenths of a degree per raw step (16384 in its
+  fixed point form), so (rawSum - baseSum) * slope stays inside a long for
+  any pair of readings.
+*/
+
+#include "TemperatureProbe.h"
+
+#define TEMP_SLOPE_SHIFT 8
+#define TEMP_MAX_SLOPE (64L << TEMP_SLOPE_SHIFT)
+
+TemperatureProbe::TemperatureProbe()
+{
+    pin = -1;
+    sampler = nullptr;
+    sum = 0;
+    partialSum = 0;
+    partialCount = 0;
+    nextSample = 0;
+    hasCalibration = false;
+    baseTenths = 0;
+    baseSum = 0;
+    slope = 0;
+}
+
+void TemperatureProbe::begin(int pin, AnalogSampler *sampler)
+{
+    this->pin = pin;
+    this->sampler = sampler;
+    sum = (unsigned int)read() * TEMP_SAMPLES;
+    partialSum = 0;
+    partialCount = 0;
+    nextSample = millis() + TEMP_SAMPLE_MS;
+}
+
+bool TemperatureProbe::started() const
+{
+    return pin != -1;
+}
+
+bool TemperatureProbe::update()
+{
+    if (pin == -1 || (long)(millis() - nextSample) < 0)
+        return false;
+
+    // Late updates don't make up for missed readings
+    nextSample = millis() + TEMP_SAMPLE_MS;
+    partialSum += read();
+    partialCount++;
+    if (partialCount < TEMP_SAMPLES)
+        return false;
+
+    sum = partialSum;
+    partialSum = 0;
+    partialCount = 0;
+    return true;
+}
+
+int TemperatureProbe::raw() const
+{
+    if (pin == -1)
+        return -1;
+    return (sum + TEMP_SAMPLES / 2) / TEMP_SAMPLES;
+}
+
+unsigned int TemperatureProbe::rawSum() const
+{
+    return sum;
+}
+
+bool TemperatureProbe::calibrate(int raw1, int tenthsC1, int raw2, int tenthsC2)
+{
+    if (raw1 < 0 || raw1 > 1023 || raw2 < 0 || raw2 > 1023 || raw1 == raw2)
+        return false;
+
+    long newSlope = ((long)(tenthsC2 - tenthsC1) << TEMP_SLOPE_SHIFT) / (raw2 - raw1);
+    if (newSlope > TEMP_MAX_SLOPE || newSlope < -TEMP_MAX_SLOPE)
+        return false;
+
+    slope = newSlope;
+    baseTenths = tenthsC1;
+    baseSum = (long)raw1 * TEMP_SAMPLES;
+    hasCalibration = true;
+    return true;
+}
+
+bool TemperatureProbe::calibrated() const
+{
+    return hasCalibration;
+}
+
+int TemperatureProbe::tenthsC() const
+{
+    if (pin == -1 || !hasCalibration)
+        return TEMP_INVALID;
+
+    long tenths = baseTenths + ((long)sum - baseSum) * slope / ((long)TEMP_SAMPLES << TEMP_SLOPE_SHIFT);
+    return constrain(tenths, TEMP_INVALID + 1, 32767L);
+}
+
+int TemperatureProbe::read()
+{
+    if (sampler != nullptr)
+        return sampler->sample(pin);
+    return analogRead(pin);
+}
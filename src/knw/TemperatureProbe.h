@@ -0,0 +1,103 @@
+// Copyright 2019 Southern Methodist University
+
+#ifndef SRC_KNW_TEMPERATUREPROBE_H_
+#define SRC_KNW_TEMPERATUREPROBE_H_
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "AnalogSampler.h"
+
+// Readings averaged into every value, and the time between two readings,
+// so a new value is ready every TEMP_SAMPLES * TEMP_SAMPLE_MS milliseconds
+#define TEMP_SAMPLES 16
+#define TEMP_SAMPLE_MS 8
+
+// Returned by tenthsC() when there is no calibrated temperature
+#define TEMP_INVALID -32768
+
+/**
+ * Samples the temperature probe in the background and keeps an average.
+ *
+ * One analogRead() is taken every TEMP_SAMPLE_MS from update(), and every
+ * TEMP_SAMPLES of them are averaged into a new value, so reading the probe
+ * never waits on the ADC and the noise of single readings averages out.
+ * The sum of the readings is kept too, which has 16 times the resolution
+ * of one reading.
+ *
+ * The probe only reads raw values until it is calibrated with two known
+ * temperatures. The calibration is a straight line through both, kept as a
+ * slope in 1/256 of a tenth of a degree per step, so turning a value into a
+ * temperature needs no floating point.
+ *
+ * Example usage:
+ *
+ * @code
+ * TemperatureProbe probe;
+ * probe.begin(8);
+ * // Read 310 in ice water and 655 in boiling water
+ * probe.calibrate(310, 0, 655, 1000);
+ *
+ * void loop() {
+ *   if (probe.update()) {
+ *     int temperature = probe.tenthsC();
+ *   }
+ * }
+ * @endcode
+ */
+class TemperatureProbe
+{
+public:
+     TemperatureProbe();
+
+     /**
+      * Starts sampling an analog pin, seeding the average with one reading.
+      * Readings come from sampler if one is given, otherwise from analogRead().
+      */
+     void begin(int pin, AnalogSampler *sampler = nullptr);
+
+     // true once begin() has been called
+     bool started() const;
+
+     // Takes a reading when one is due. Returns true when a new value is ready.
+     bool update();
+
+     // Latest average [0 - 1023], or -1 if not started
+     int raw() const;
+
+     // Sum of the readings in the latest average [0 - 1023 * TEMP_SAMPLES]
+     unsigned int rawSum() const;
+
+     /**
+      * Calibrates with two raw readings and the temperatures, in tenths of a
+      * degree C, they were taken at. Returns false if the readings are out of
+      * range, too close together for the temperatures, or the same.
+      */
+     bool calibrate(int raw1, int tenthsC1, int raw2, int tenthsC2);
+
+     bool calibrated() const;
+
+     // Latest temperature in tenths of a degree C, or TEMP_INVALID
+     int tenthsC() const;
+
+private:
+     int pin;
+     AnalogSampler *sampler;
+     unsigned int sum;
+     unsigned int partialSum;
+     uint8_t partialCount;
+     unsigned long nextSample;
+
+     // Calibration line: tenthsC = baseTenths + (rawSum - baseSum) * slope / (256 * TEMP_SAMPLES)
+     bool hasCalibration;
+     int baseTenths;
+     long baseSum;
+     long slope;
+
+     int read();
+};
+
+#endif // SRC_KNW_TEMPERATUREPROBE_H_